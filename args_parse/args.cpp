@@ -1,6 +1,6 @@
 ﻿#include "args.hpp"
 #include "validator.hpp"
-#include <iostream>
+#include "trace.hpp"
 
 namespace args_parse {
 	/// @brief возвращаем имя короткого аргумента
@@ -16,26 +16,42 @@ namespace args_parse {
 	/// @brief установка короткого имени аргумента
 	void Arg::setShortName(char shortName) {
 		shortName_ = shortName;
+		++revision_;
 	}
 
 	/// @brief установка длинного имени аргумента
 	void Arg::setLongName(const std::string& longName) {
 		longName_ = longName;
+		++revision_;
+	}
+
+	/// @brief имя аргумента в том виде, в котором оно пишется в командной строке
+	std::string Arg::displayName() const {
+		if (!longName_.empty())
+			return "--" + longName_;
+		return std::string("-") + shortName_;
 	}
 
 	/// @brief добавление аргумента в парсер
 	bool ArgsParser::add(Arg* arg) {
+		// ошибки добавления сохраняются отдельно, чтобы parse не терял их при очистке списка
+		auto fail = [this](ErrorCode code, std::string argument) {
+			report(code, std::move(argument));
+			setupDiagnostics_.push_back(diagnostics_.back());
+			return false;
+		};
+
 		// проверка: имя у аргумента не пустое
 		if (!Validator::validateNewArgument(arg))
-			return false;
+			return fail(ErrorCode::NullArgument, {});
 
 		// проверка: короткое имя у аргумента не дублирует имена существующих
 		if (!Validator::validateShortExists(arg, shortNameArgs_))
-			return false;
+			return fail(ErrorCode::DuplicateShortName, std::string("-") + arg->shortName());
 
 		// проверка: длинное имя у аргумента не дублирует имена существующих
 		if (!Validator::validateLongExists(arg, longNameArgs_))
-			return false;
+			return fail(ErrorCode::DuplicateLongName, "--" + arg->longName());
 
 		// если имя не пустое, добавить в список коротких имен
 		if (arg->shortName() != '\0') {
@@ -46,19 +62,115 @@ namespace args_parse {
 		if (!arg->longName().empty()) {
 			longNameArgs_[arg->longName()] = arg;
 		}
+		args_.push_back(arg);
+		helpCached_ = false;
+		nameTreeBuilt_ = false;
 		return true;
 	}
 
-	/// @brief вывести справку
+	/// @brief вывести справку одним вызовом write
 	void ArgsParser::printHelp() const {
-		std::cout << "Usage:\t[options]\t[description]" << std::endl;
-		for (const auto& pair : longNameArgs_) {
-			std::cout << "  -" << pair.second->shortName() << ", --" << pair.first << "    " << pair.second->GetDescription() << std::endl;
+		writeAll(1, helpText());
+	}
+
+	/// @brief получить текст справки, при необходимости сформировав его
+	const std::string& ArgsParser::helpText() const {
+		// описание и группу можно поменять и после add, поэтому кэш сверяется со счетчиками аргументов
+		uint64_t revision = 0;
+		for (const Arg* arg : args_)
+			revision += arg->revision();
+		if (!helpCached_ || revision != helpRevision_) {
+			helpCache_ = renderHelp();
+			helpCached_ = true;
+			helpRevision_ = revision;
+		}
+		return helpCache_;
+	}
+
+	/// @brief ширина колонки с именами аргумента: "-s, --long"
+	static size_t helpNameWidth(const Arg* arg) {
+		// "-s" и ", " либо отступ такой же ширины
+		size_t width = 4;
+		if (!arg->longName().empty())
+			width += 2 + arg->longName().size();
+		return width;
+	}
+
+	/// @brief сформировать справку: аргументы по группам в порядке добавления, описания выровнены в колонку
+	std::string ArgsParser::renderHelp() const {
+		// номер группы в порядке первого появления, аргументы без группы идут первыми
+		std::unordered_map<std::string_view, size_t> groupRanks{ { std::string_view(), 0 } };
+		std::vector<std::pair<size_t, const Arg*>> ordered;
+		ordered.reserve(args_.size());
+		size_t nameWidth = 0;
+		size_t totalSize = 0;
+		for (const Arg* arg : args_) {
+			const size_t rank = groupRanks.emplace(arg->GetGroup(), groupRanks.size()).first->second;
+			ordered.emplace_back(rank, arg);
+			nameWidth = std::max(nameWidth, helpNameWidth(arg));
+			totalSize += arg->GetDescription().size() + arg->GetGroup().size();
+		}
+		std::stable_sort(ordered.begin(), ordered.end(),
+			[](const auto& left, const auto& right) { return left.first < right.first; });
+
+		const size_t indent = 2;
+		const size_t gap = 4;
+		std::string text = "Usage:\t[options]\t[description]\n";
+		text.reserve(text.size() + totalSize + args_.size() * (indent + nameWidth + gap + 1) + groupRanks.size() * 3);
+
+		size_t currentRank = 0;
+		for (const auto& [rank, arg] : ordered) {
+			// заголовок группы перед ее первым аргументом
+			if (rank != currentRank) {
+				currentRank = rank;
+				text += '\n';
+				text += arg->GetGroup();
+				text += ":\n";
+			}
+			const size_t lineStart = text.size();
+			text.append(indent, ' ');
+			if (arg->shortName() != '\0') {
+				text += '-';
+				text += arg->shortName();
+				if (!arg->longName().empty())
+					text += ", ";
+			}
+			else {
+				text.append(4, ' ');
+			}
+			if (!arg->longName().empty()) {
+				text += "--";
+				text += arg->longName();
+			}
+			text.append(lineStart + indent + nameWidth + gap - text.size(), ' ');
+			text += arg->GetDescription();
+			text += '\n';
 		}
+		return text;
+	}
+
+	/// @brief зарегистрировать ошибку и передать ее в приемник
+	void ArgsParser::report(ErrorCode code, std::string argument, std::string_view token) {
+		diagnostics_.push_back(Diagnostic{ code, std::move(argument), std::string(token) });
+		if (sink_)
+			sink_(diagnostics_.back());
+	}
+
+	/// @brief зарегистрировать ошибку, которую вернул setValue
+	void ArgsParser::reportValue(const Arg* arg, ErrorCode code, const std::string_view& value) {
+		if (code != ErrorCode::None)
+			report(code, arg->displayName(), value);
 	}
 
 	/// @briefобработать значения командной строки
 	void ArgsParser::parse(int argc, const char** argv) {
+		// этапы разбора записываются в трассировку, если она включена
+		TraceSpan parseSpan("ArgsParser::parse");
+		parseSpan.setArg1("argc", static_cast<uint64_t>(argc));
+		TraceSpan phaseSpan("ArgsParser::parse/argv");
+		given_.clear();
+		// ошибки предыдущего разбора не переносятся в новый, ошибки добавления аргументов остаются
+		diagnostics_ = setupDiagnostics_;
 		for (int i = 1; i < argc; ++i) {
 			std::string_view arg = argv[i];
 			if (arg.size() > 1 && arg[0] == '-') {
@@ -99,6 +211,64 @@ namespace args_parse {
 				}
 			}
 		}
+		phaseSpan.restart("ArgsParser::parse/sources");
+		resolveSources();
+		phaseSpan.restart("ArgsParser::parse/constraints");
+		checkConstraints();
+	}
+
+	/// @brief проверить обязательные и взаимоисключающие аргументы
+	void ArgsParser::checkConstraints() {
+		for (const Arg* arg : args_) {
+			if (arg->isRequired() && !arg->isDefined())
+				report(ErrorCode::MissingRequired, arg->displayName());
+		}
+		for (const auto& group : exclusiveGroups_) {
+			const Arg* first = nullptr;
+			for (const Arg* arg : group) {
+				if (!arg->isDefined())
+					continue;
+				if (!first)
+					first = arg;
+				else
+					report(ErrorCode::MutuallyExclusive, arg->displayName(), first->displayName());
+			}
+		}
+	}
+
+	/// @brief взять значения отсутствующих аргументов из окружения, а затем из конфигурационного файла
+	void ArgsParser::resolveSources() {
+		if (!environment_.enabled() && !configFile_)
+			return;
+		bool configConsulted = false;
+		for (Arg* arg : args_) {
+			// источники опрашиваются только для аргументов, которых нет в командной строке
+			if (arg->longName().empty() || given_.count(arg) != 0 || exclusivePeerGiven(arg))
+				continue;
+			std::string_view value;
+			bool found = environment_.find(arg->longName(), value);
+			if (!found && configFile_) {
+				configConsulted = true;
+				found = configFile_->find(arg->longName(), value);
+			}
+			if (found)
+				reportValue(arg, arg->setValue(value), value);
+		}
+		if (configConsulted && !configFile_->load())
+			report(ErrorCode::ConfigFileUnavailable, {}, configFile_->path());
+	}
+
+	/// @brief проверить, задан ли в командной строке другой аргумент из взаимоисключающей группы
+	bool ArgsParser::exclusivePeerGiven(const Arg* arg) const {
+		for (const auto& group : exclusiveGroups_) {
+			if (std::find(group.begin(), group.end(), arg) == group.end())
+				continue;
+			for (const Arg* peer : group) {
+				if (peer != arg && given_.count(peer) != 0)
+					return true;
+			}
+		}
+		return false;
 	}
 
 	/// @brief обработать короткие и сокращенные аргументы
@@ -108,7 +278,7 @@ namespace args_parse {
 			executeArgument(iter->second, argc, argv, i);
 		}
 		else {
-			std::cerr << "Error: Unknown argument '-" << shortName << "'" << std::endl;
+			report(ErrorCode::UnknownArgument, std::string("-") + shortName);
 		}
 	}
 
@@ -119,42 +289,106 @@ namespace args_parse {
 			executeEquals(iter->second, value);
 		}
 		else {
-			std::cerr << "Error: Unknown argument '-" << shortName << "'" << std::endl;
+			report(ErrorCode::UnknownArgument, std::string("-") + shortName);
 		}
 	}
 
 	/// @brief обработать длинные аргументы
 	void ArgsParser::parseLongArgument(const std::string_view& longName, int argc, const char** argv, int& i) {
-		auto iter = longNameArgs_.find(longName);
-		if (iter != longNameArgs_.end()) {
-			executeArgument(iter->second, argc, argv, i);
-		}
-		else {
-			std::cerr << "Error: Unknown argument '--" << longName << "'" << std::endl;
-		}
+		if (Arg* arg = findLong(longName))
+			executeArgument(arg, argc, argv, i);
 	}
 	/// @brief обработать длинные аргументы со знаком равно
 	void ArgsParser::parseLongArgumentEquals(const std::string_view& longName, const std::string_view& value) {
+		if (Arg* arg = findLong(longName))
+			executeEquals(arg, value);
+	}
+
+	/// @brief найти аргумент по точному длинному имени
+	Arg* ArgsParser::findByLongName(std::string_view longName) const {
 		auto iter = longNameArgs_.find(longName);
-		if (iter != longNameArgs_.end()) {
-			executeEquals(iter->second, value);
+		return iter != longNameArgs_.end() ? iter->second : nullptr;
+	}
+
+	/// @brief найти аргумент по короткому имени
+	Arg* ArgsParser::findByShortName(char shortName) const {
+		auto iter = shortNameArgs_.find(shortName);
+		return iter != shortNameArgs_.end() ? iter->second : nullptr;
+	}
+
+	/// @brief построить префиксное дерево длинных имен, если оно устарело
+	const NameTree& ArgsParser::nameTree() {
+		if (!nameTreeBuilt_) {
+			std::vector<std::string_view> names;
+			std::vector<int> ids;
+			for (size_t i = 0; i < args_.size(); ++i) {
+				if (!args_[i]->longName().empty()) {
+					names.push_back(args_[i]->longName());
+					ids.push_back(static_cast<int>(i));
+				}
+			}
+			nameTree_.build(names, ids);
+			nameTreeBuilt_ = true;
 		}
-		else {
-			std::cerr << "Error: Unknown argument '--" << longName << "'" << std::endl;
+		return nameTree_;
+	}
+
+	/// @brief найти аргумент: точное имя по хеш-таблице, затем однозначный префикс по дереву;
+	/// для неизвестного имени в ошибку добавляются ближайшие по расстоянию Левенштейна имена
+	Arg* ArgsParser::findLong(const std::string_view& longName) {
+		auto iter = longNameArgs_.find(longName);
+		if (iter != longNameArgs_.end())
+			return iter->second;
+		// пустое имя (одиночный --) - префикс любого имени, сокращением его не считаем
+		if (longName.empty()) {
+			report(ErrorCode::UnknownArgument, "--");
+			return nullptr;
 		}
+
+		const NameTree& tree = nameTree();
+		const size_t maxCandidates = 3;
+		auto joinNames = [&](const std::vector<int>& ids) {
+			std::string names;
+			for (int id : ids) {
+				if (!names.empty())
+					names += ", ";
+				names += "'--" + args_[id]->longName() + "'";
+			}
+			return names;
+		};
+
+		if (allowAbbreviations_) {
+			const int id = tree.resolvePrefix(longName);
+			if (id >= 0)
+				return args_[id];
+			if (id == NameTree::Ambiguous) {
+				report(ErrorCode::AmbiguousArgument, "--" + std::string(longName), joinNames(tree.completions(longName, maxCandidates)));
+				return nullptr;
+			}
+		}
+
+		// допустимое число опечаток растет с длиной имени, но не больше двух
+		const size_t maxDistance = std::min<size_t>(2, 1 + longName.size() / 4);
+		std::vector<int> ids;
+		for (const auto& suggestion : tree.suggest(longName, maxDistance, maxCandidates))
+			ids.push_back(suggestion.id);
+		report(ErrorCode::UnknownArgument, "--" + std::string(longName), joinNames(ids));
+		return nullptr;
 	}
 
 	/// @brief добавить значения к аргументам
 	void ArgsParser::executeArgument(Arg* arg, int argc, const char** argv, int& i) {
+		given_.insert(arg);
 		while (i + 1 < argc) {
-			std::string value = argv[i + 1];
+			std::string_view value = argv[i + 1];
 			if (value.empty() || value[0] == '-')
 				break;
-			arg->setValue(value);
+			reportValue(arg, arg->setValue(value), value);
 			++i;
 		}
 	}
 	void ArgsParser::executeEquals(Arg* arg, const std::string_view& value) {
-		arg->setValue(value);
+		given_.insert(arg);
+		reportValue(arg, arg->setValue(value), value);
 	}
 } // namespace args_parse
\ No newline at end of file
@@ -1,12 +1,38 @@
 ﻿#pragma once
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include <iostream>
+#include <unordered_set>
+#include <vector>
 #include <chrono>
-#include <sstream>
+#include <charconv>
+#include <algorithm>
+#include <memory>
+#include <cstdint>
+#include <variant>
+#include <iterator>
+#include <cstring>
+#include <type_traits>
+#include <functional>
+#include "diagnostics.hpp"
+#include "constraints.hpp"
+#include "sources.hpp"
+#include "name_tree.hpp"
 
 namespace args_parse {
+	/// @brief Тип значения аргумента, используется там, где значение обрабатывается без объекта аргумента
+	enum class ValueType : uint8_t {
+		Unknown,
+		Bool,
+		Int,
+		Float,
+		String,
+		Chrono,
+	};
+
+	class ValueColumn;
+
 	/// @brief Класс для представления аргументов командной строки
 	class Arg {
 	public:
@@ -23,17 +49,47 @@ namespace args_parse {
 		char shortName() const;
 		const std::string& longName() const;
 
-		//виртуальный метод для установки значения аргумента
-		virtual void setValue(const std::string_view& value) = 0;
+		//виртуальный метод для установки значения аргумента, возвращает код ошибки
+		virtual ErrorCode setValue(const std::string_view& value) = 0;
+		//виртуальный метод для преобразования значения без изменения аргумента, значения дописываются в column
+		virtual ErrorCode decode(const std::string_view& value, ValueColumn& column) const = 0;
+		//виртуальные методы для сохранения значения в двоичном виде и загрузки из него (см. snapshot.hpp);
+		//load только разбирает данные во временные значения и возвращает функцию, переносящую их в аргумент,
+		//либо пустую функцию, если данные повреждены, - так несколько аргументов загружаются все или ни один
+		virtual void save(std::string& out) const = 0;
+		virtual std::function<void()> load(std::string_view& in) = 0;
+		//виртуальный метод для проверки определенности аргумента
+		virtual bool isDefined() const = 0;
+		//виртуальные методы для описания значения: тип, множественность и список допустимых значений
+		virtual ValueType valueType() const = 0;
+		virtual bool isMulti() const = 0;
+		virtual const ChoiceSet& choices() const = 0;
+
+		//методы для установки и проверки обязательности аргумента
+		void setRequired(bool required) { required_ = required; }
+		bool isRequired() const { return required_; }
 
 		//методы для установки и получения описания аргумента
-		std::string GetDescription() const { return description_; }
-		void SetDescription(const std::string& description) { description_ = description; }
+		const std::string& GetDescription() const { return description_; }
+		void SetDescription(const std::string& description) { description_ = description; ++revision_; }
+
+		//методы для установки и получения группы, под которой аргумент выводится в справке
+		const std::string& GetGroup() const { return group_; }
+		void SetGroup(const std::string& group) { group_ = group; ++revision_; }
+
+		// имя в том виде, в котором оно пишется в командной строке: --long или -s
+		std::string displayName() const;
+
+		// счетчик изменений имен, описания и группы; по нему парсер узнает, что кэш справки устарел
+		uint64_t revision() const { return revision_; }
 
 	private:
 		char shortName_;
 		std::string longName_;
 		std::string description_;
+		std::string group_;
+		bool required_ = false;
+		uint64_t revision_ = 0;
 	};
 
 	/// @brief пользовательский класс для подсчета времени
@@ -48,20 +104,120 @@ namespace args_parse {
 		bool ParseUserChrono(UserChrono& userChrono, const std::string& operand);
 	};
 
+	/// @brief преобразование числа из строки без копирования и исключений; ptr сдвигается за последний прочитанный символ
+	template<typename T>
+	inline bool ParseNumberPrefix(const char*& ptr, const char* last, T& result) {
+		const char* first = ptr;
+		// from_chars не принимает ведущий '+', в отличие от std::stoi
+		if (first != last && *first == '+')
+			++first;
+		auto [next, ec] = std::from_chars(first, last, result);
+		if (ec != std::errc() || next == first)
+			return false;
+		ptr = next;
+		return true;
+	}
+
+	/// @brief преобразование всей строки в число, лишние символы в конце считаются ошибкой
+	template<typename T>
+	inline bool ParseNumber(const std::string_view& text, T& result) {
+		const char* ptr = text.data();
+		const char* last = ptr + text.size();
+		return ParseNumberPrefix(ptr, last, result) && ptr == last;
+	}
+
+	/// @brief компактный диапазон целых чисел [first, last], значения перебираются лениво
+	class IntRange {
+	public:
+		/// @brief итератор по значениям диапазона
+		class iterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = int;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const int*;
+			using reference = int;
+
+			explicit iterator(long long current) : current_(current) {}
+			int operator*() const { return static_cast<int>(current_); }
+			iterator& operator++() { ++current_; return *this; }
+			bool operator==(const iterator& other) const { return current_ == other.current_; }
+			bool operator!=(const iterator& other) const { return current_ != other.current_; }
+		private:
+			// long long, чтобы end() для диапазона до INT_MAX не переполнялся
+			long long current_;
+		};
+
+		IntRange(int first, int last, uint32_t position = 0) : first_(first), last_(last), position_(position) {}
+
+		int first() const { return first_; }
+		int last() const { return last_; }
+		// количество одиночных значений, заданных до диапазона; восстанавливает исходный порядок элементов
+		uint32_t position() const { return position_; }
+		// количество значений в диапазоне
+		size_t size() const { return static_cast<size_t>(static_cast<long long>(last_) - first_ + 1); }
+		// проверка принадлежности значения диапазону
+		bool contains(int value) const { return value >= first_ && value <= last_; }
+
+		iterator begin() const { return iterator(first_); }
+		iterator end() const { return iterator(static_cast<long long>(last_) + 1); }
+
+		// сравнивает границы и позицию: одинаковые диапазоны в разных местах списка не равны
+		bool operator==(const IntRange& other) const {
+			return first_ == other.first_ && last_ == other.last_ && position_ == other.position_;
+		}
+
+	private:
+		int first_;
+		int last_;
+		uint32_t position_;
+	};
+
+	/// @brief разбор списка чисел через запятую за один проход, например 1,2,3
+	/// Если ranges не нулевой, элементы вида 0-4095 сохраняются как диапазоны без развертывания.
+	/// Каждое число сразу после преобразования проверяется функцией check, возвращающей код ошибки.
+	/// Значения дописываются в конец values и ranges; при ошибке содержимое остается частично дописанным.
+	template<typename T, typename Check>
+	inline ErrorCode ParseNumberList(const std::string_view& text, std::vector<T>& values, std::vector<IntRange>* ranges, const Check& check) {
+		const char* ptr = text.data();
+		const char* last = ptr + text.size();
+		if (ptr == last)
+			return ErrorCode::InvalidValue;
+		values.reserve(values.size() + std::count(ptr, last, ',') + 1);
+		while (true) {
+			T number;
+			if (!ParseNumberPrefix(ptr, last, number))
+				return ErrorCode::InvalidValue;
+			if (ErrorCode code = check(number); code != ErrorCode::None)
+				return code;
+			if (ranges && ptr != last && *ptr == '-') {
+				// диапазон: второе число идет сразу после '-'
+				++ptr;
+				T upper;
+				if (!ParseNumberPrefix(ptr, last, upper) || upper < number)
+					return ErrorCode::InvalidValue;
+				if (ErrorCode code = check(upper); code != ErrorCode::None)
+					return code;
+				ranges->emplace_back(number, upper, static_cast<uint32_t>(values.size()));
+			}
+			else {
+				values.push_back(number);
+			}
+			if (ptr == last)
+				return ErrorCode::None;
+			// после числа допустима только запятая, за которой есть следующий элемент
+			if (*ptr != ',' || ++ptr == last)
+				return ErrorCode::InvalidValue;
+		}
+	}
+
 	/// @brief ожидает операнд в виде [число][единица измерения], например 12s, 12d, 12m
 	inline bool ParseUserChrono(UserChrono& userChrono, const std::string_view& operand) {
-		//std::stringstream ss{ operand.data() };
 		if (operand.size() < 2) // Ensure operand has at least two characters
 			return false;
-		// string_view error message
 		long long value;
 		char type = operand.back();
-		std::string valueStr = std::string(operand).substr(0, operand.size() - 1);
-		std::stringstream ss{ valueStr.data() };
-
-		ss >> value;
-
-		if (!ss || ss.rdbuf()->in_avail() != 0)
+		if (!ParseNumber(operand.substr(0, operand.size() - 1), value))
 			return false;
 
 		std::chrono::microseconds user;
@@ -91,6 +247,110 @@ namespace args_parse {
 		return true;
 	}
 
+	/// @brief соответствие типа C++ типу значения аргумента
+	template<typename T> struct ValueTypeOf { static constexpr ValueType value = ValueType::Unknown; };
+	template<> struct ValueTypeOf<bool> { static constexpr ValueType value = ValueType::Bool; };
+	template<> struct ValueTypeOf<int> { static constexpr ValueType value = ValueType::Int; };
+	template<> struct ValueTypeOf<float> { static constexpr ValueType value = ValueType::Float; };
+	template<> struct ValueTypeOf<std::string> { static constexpr ValueType value = ValueType::String; };
+	template<> struct ValueTypeOf<UserChrono> { static constexpr ValueType value = ValueType::Chrono; };
+
+	/// @brief запись значения в двоичном виде: числа в порядке байтов машины, строки с длиной впереди
+	template<typename T>
+	inline void SaveRaw(std::string& out, const T& value) {
+		static_assert(std::is_trivially_copyable_v<T>, "SaveRaw requires a trivially copyable type");
+		out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	/// @brief чтение значения, записанного SaveRaw; in сдвигается за прочитанные байты
+	template<typename T>
+	inline bool LoadRaw(std::string_view& in, T& value) {
+		static_assert(std::is_trivially_copyable_v<T>, "LoadRaw requires a trivially copyable type");
+		if (in.size() < sizeof(T))
+			return false;
+		std::memcpy(&value, in.data(), sizeof(T));
+		in.remove_prefix(sizeof(T));
+		return true;
+	}
+
+	// сохранение и загрузка значений поддерживаемых типов; для остальных типов сохранение невозможно
+	template<typename T>
+	inline void SaveValue(std::string&, const T&) {}
+	template<typename T>
+	inline bool LoadValue(std::string_view&, T&) { return false; }
+
+	inline void SaveValue(std::string& out, int value) { SaveRaw<int32_t>(out, value); }
+	inline void SaveValue(std::string& out, float value) { SaveRaw(out, value); }
+	inline void SaveValue(std::string& out, bool value) { SaveRaw<uint8_t>(out, value ? 1 : 0); }
+	inline void SaveValue(std::string& out, const UserChrono& value) { SaveRaw<int64_t>(out, value.GetMicroseconds().count()); }
+	inline void SaveValue(std::string& out, const std::string& value) {
+		SaveRaw(out, static_cast<uint32_t>(value.size()));
+		out += value;
+	}
+
+	inline bool LoadValue(std::string_view& in, int& value) {
+		int32_t stored;
+		if (!LoadRaw(in, stored))
+			return false;
+		value = stored;
+		return true;
+	}
+	inline bool LoadValue(std::string_view& in, float& value) { return LoadRaw(in, value); }
+	inline bool LoadValue(std::string_view& in, bool& value) {
+		uint8_t stored;
+		if (!LoadRaw(in, stored) || stored > 1)
+			return false;
+		value = stored != 0;
+		return true;
+	}
+	inline bool LoadValue(std::string_view& in, UserChrono& value) {
+		int64_t stored;
+		if (!LoadRaw(in, stored))
+			return false;
+		value = UserChrono{ std::chrono::microseconds(stored) };
+		return true;
+	}
+	inline bool LoadValue(std::string_view& in, std::string& value) {
+		uint32_t size;
+		if (!LoadRaw(in, size) || in.size() < size)
+			return false;
+		value.assign(in.data(), size);
+		in.remove_prefix(size);
+		return true;
+	}
+
+	/// @brief Типизированный массив значений одного аргумента, заполняется методом Arg::decode
+	class ValueColumn {
+	public:
+		// массив значений типа T; создается при первом обращении
+		template<typename T>
+		std::vector<T>& values() {
+			if (std::holds_alternative<std::monostate>(storage_))
+				storage_.template emplace<std::vector<T>>();
+			return std::get<std::vector<T>>(storage_);
+		}
+		// массив значений типа T или пустой массив, если значений такого типа нет
+		template<typename T>
+		const std::vector<T>& values() const {
+			static const std::vector<T> empty;
+			const auto* stored = std::get_if<std::vector<T>>(&storage_);
+			return stored ? *stored : empty;
+		}
+		// количество значений
+		size_t size() const {
+			return std::visit([](const auto& stored) -> size_t {
+				if constexpr (std::is_same_v<std::decay_t<decltype(stored)>, std::monostate>)
+					return 0;
+				else
+					return stored.size();
+			}, storage_);
+		}
+
+	private:
+		std::variant<std::monostate, std::vector<bool>, std::vector<int>, std::vector<float>,
+			std::vector<std::string>, std::vector<UserChrono>> storage_;
+	};
+
 	/// @brief Шаблон класса для аргумента с единственным значением
 	template<typename T>
 	class SingleArg : public Arg {
@@ -99,45 +359,251 @@ namespace args_parse {
 		SingleArg(const std::string& longName) : Arg(longName) {}
 		SingleArg() {}
 
-		// ref to template function
 		// метод для установки значения аргумента
-		void setValue(const std::string_view& value) override
+		ErrorCode setValue(const std::string_view& value) override
 		{
-			std::cerr << "Error: Unsupported type for SingleArg setValue: " << value << std::endl;
+			T parsed;
+			if (ErrorCode code = convert(value, parsed); code != ErrorCode::None)
+				return code;
+			value_ = std::move(parsed);
+			defined_ = true;
+			return ErrorCode::None;
+		}
+
+		// метод для преобразования значения в column без изменения аргумента
+		ErrorCode decode(const std::string_view& value, ValueColumn& column) const override
+		{
+			if constexpr (ValueTypeOf<T>::value == ValueType::Unknown) {
+				(void)value;
+				(void)column;
+				return ErrorCode::UnsupportedType;
+			}
+			else {
+				T parsed;
+				ErrorCode code = convert(value, parsed);
+				if (code == ErrorCode::None)
+					column.values<T>().push_back(std::move(parsed));
+				return code;
+			}
+		}
+
+		// метод для сохранения значения в двоичном виде
+		void save(std::string& out) const override
+		{
+			SaveValue(out, value_);
+		}
+
+		// метод для загрузки значения, сохраненного методом save
+		std::function<void()> load(std::string_view& in) override
+		{
+			T loaded;
+			if (!LoadValue(in, loaded))
+				return {};
+			return [this, loaded = std::move(loaded)]() mutable {
+				value_ = std::move(loaded);
+				defined_ = true;
+			};
+		}
+
+		// ref to template function
+		// преобразование строки в значение с проверкой ограничений
+		ErrorCode convert(const std::string_view& value, T& out) const
+		{
+			(void)value;
+			(void)out;
+			return ErrorCode::UnsupportedType;
 		}
 
 		// метод для получения значения аргумента
 		const T& value() const { return value_; }
 		// метод для проверки определенности аргумента
-		bool isDefined() const { return defined_; }
+		bool isDefined() const override { return defined_; }
+		// описание значения
+		ValueType valueType() const override { return ValueTypeOf<T>::value; }
+		bool isMulti() const override { return false; }
+		const ChoiceSet& choices() const override { return constraints_.choices(); }
+
+		// ограничения на значение, проверяются при установке значения
+		void setRange(const T& min, const T& max) { constraints_.setRange(min, max); }
+		void setChoices(std::vector<std::string> choices) { constraints_.setChoices(std::move(choices)); }
+		void setPrefix(const std::string& prefix) { constraints_.setPrefix(prefix); }
+		void setPattern(const std::string& pattern) { constraints_.setPattern(pattern); }
+		const ValueConstraints<T>& constraints() const { return constraints_; }
 
 	private:
-		T value_;
+		T value_{};
 		bool defined_ = false;
+		ValueConstraints<T> constraints_;
 	};
 
+	/// @brief обход одиночных значений и диапазонов в исходном порядке: диапазон с position() == i
+	/// идет перед values[i]
+	template<typename T, typename F>
+	inline void ForEachInOrder(const std::vector<T>& values, const std::vector<IntRange>& ranges, F&& f) {
+		size_t next = 0;
+		for (const auto& range : ranges) {
+			for (; next < range.position() && next < values.size(); ++next)
+				f(values[next]);
+			if constexpr (std::is_same_v<T, int>) {
+				for (int number : range)
+					f(number);
+			}
+		}
+		for (; next < values.size(); ++next)
+			f(values[next]);
+	}
+
 	/// @brief Шаблон класса для аргумента с множественным значением
 	template<typename T>
 	class MultiArg : public Arg {
 	public:
+		// наибольшее количество значений, в которое decode разворачивает диапазоны одного токена
+		static constexpr size_t MaxDecodedRangeValues = size_t(1) << 20;
+
 		MultiArg(char shortName, const std::string& longName) : Arg(shortName, std::move(longName)) {}
 		MultiArg(const std::string& longName) : Arg(std::move(longName)) {}
 		MultiArg() {}
 
-		//ref to template
 		// метод для установки значения аргумента
-		void setValue(const std::string_view& value) override
+		ErrorCode setValue(const std::string_view& value) override
 		{
-			std::cerr << "Error: Unsupported type for SingleArg setValue: " << value << std::endl;
+			return convert(value, values_, &ranges_);
 		}
 
-		// метод для получения значения аргумента
-		const std::vector<T>& values() const { return values_; }
+		// метод для преобразования значений в column без изменения аргумента
+		ErrorCode decode(const std::string_view& value, ValueColumn& column) const override
+		{
+			if constexpr (ValueTypeOf<T>::value == ValueType::Unknown) {
+				(void)value;
+				(void)column;
+				return ErrorCode::UnsupportedType;
+			}
+			else if constexpr (std::is_same_v<T, int>) {
+				// диапазоны разворачиваются в порядке токена, чтобы столбец оставался плоским массивом;
+				// размер развертывания ограничен, иначе 0-2147483647 потребовал бы 8 ГБ
+				std::vector<int> values;
+				std::vector<IntRange> ranges;
+				ErrorCode code = convert(value, values, &ranges);
+				if (code != ErrorCode::None)
+					return code;
+				size_t expanded = 0;
+				for (const auto& range : ranges) {
+					expanded += range.size();
+					if (expanded > MaxDecodedRangeValues)
+						return ErrorCode::RangeTooLarge;
+				}
+				ForEachInOrder(values, ranges, [&out = column.values<int>()](int number) { out.push_back(number); });
+				return code;
+			}
+			else {
+				return convert(value, column.values<T>(), nullptr);
+			}
+		}
+
+		// метод для сохранения значений в двоичном виде: количество и значения, затем количество и границы диапазонов
+		void save(std::string& out) const override
+		{
+			SaveRaw(out, static_cast<uint32_t>(values_.size()));
+			for (const auto& value : values_)
+				SaveValue(out, value);
+			SaveRaw(out, static_cast<uint32_t>(ranges_.size()));
+			for (const auto& range : ranges_) {
+				SaveRaw<int32_t>(out, range.first());
+				SaveRaw<int32_t>(out, range.last());
+				SaveRaw<uint32_t>(out, range.position());
+			}
+		}
+
+		// метод для загрузки значений, сохраненных методом save; текущие значения заменяются при вызове результата
+		std::function<void()> load(std::string_view& in) override
+		{
+			std::vector<T> values;
+			std::vector<IntRange> ranges;
+			uint32_t count;
+			if (!LoadRaw(in, count))
+				return {};
+			for (uint32_t i = 0; i < count; ++i) {
+				T value;
+				if (!LoadValue(in, value))
+					return {};
+				values.push_back(std::move(value));
+			}
+			if (!LoadRaw(in, count))
+				return {};
+			for (uint32_t i = 0; i < count; ++i) {
+				int32_t first;
+				int32_t last;
+				uint32_t position;
+				if (!LoadRaw(in, first) || !LoadRaw(in, last) || !LoadRaw(in, position) || last < first)
+					return {};
+				// позиции не убывают и не выходят за список одиночных значений
+				if (position > values.size() || (!ranges.empty() && position < ranges.back().position()))
+					return {};
+				ranges.emplace_back(first, last, position);
+			}
+			return [this, values = std::move(values), ranges = std::move(ranges)]() mutable {
+				values_ = std::move(values);
+				ranges_ = std::move(ranges);
+			};
+		}
+
+		//ref to template
+		// преобразование строки с проверкой ограничений; значения дописываются в out,
+		// диапазоны - в ranges (только для int); при ошибке out и ranges не меняются
+		ErrorCode convert(const std::string_view& value, std::vector<T>& out, std::vector<IntRange>* ranges) const
+		{
+			(void)value;
+			(void)out;
+			(void)ranges;
+			return ErrorCode::UnsupportedType;
+		}
+
+		// метод для получения всех значений аргумента в порядке командной строки.
+		// Для MultiArg<int> диапазоны разворачиваются (--ids=5,0-3,7 -> 5 0 1 2 3 7), поэтому возвращается копия;
+		// для остальных типов - ссылка на хранимый вектор. Обход без выделения памяти дает forEach()
+		decltype(auto) values() const {
+			if constexpr (std::is_same_v<T, int>) {
+				std::vector<T> result;
+				result.reserve(count());
+				forEach([&result](const T& value) { result.push_back(value); });
+				return result;
+			}
+			else {
+				return (values_);
+			}
+		}
+		// метод для получения одиночных значений без элементов вида 0-3 (те доступны через ranges())
+		const std::vector<T>& singles() const { return values_; }
+		// метод для получения диапазонов значений вида 0-4095 (только для MultiArg<int>)
+		const std::vector<IntRange>& ranges() const { return ranges_; }
+		// обход всех значений в порядке командной строки с развертыванием диапазонов без выделения памяти
+		template<typename F>
+		void forEach(F&& f) const { ForEachInOrder(values_, ranges_, f); }
+		// общее количество значений с учетом диапазонов
+		size_t count() const {
+			size_t total = values_.size();
+			for (const auto& range : ranges_)
+				total += range.size();
+			return total;
+		}
 		// метод для проверки определенности аргумента
-		bool isDefined() const { return !values_.empty(); }
+		bool isDefined() const override { return !values_.empty() || !ranges_.empty(); }
+		// описание значения
+		ValueType valueType() const override { return ValueTypeOf<T>::value; }
+		bool isMulti() const override { return true; }
+		const ChoiceSet& choices() const override { return constraints_.choices(); }
+
+		// ограничения на каждое значение, проверяются при добавлении значения
+		void setRange(const T& min, const T& max) { constraints_.setRange(min, max); }
+		void setChoices(std::vector<std::string> choices) { constraints_.setChoices(std::move(choices)); }
+		void setPrefix(const std::string& prefix) { constraints_.setPrefix(prefix); }
+		void setPattern(const std::string& pattern) { constraints_.setPattern(pattern); }
+		const ValueConstraints<T>& constraints() const { return constraints_; }
 
 	private:
 		std::vector<T> values_;
+		std::vector<IntRange> ranges_;
+		ValueConstraints<T> constraints_;
 	};
 
 	/// @brief Класс для парсинга аргументов командной строки
@@ -147,6 +613,13 @@ namespace args_parse {
 		bool add(Arg* arg);
 		//вывод справки о доступных аргументах
 		void printHelp() const;
+		// текст справки; формируется один раз и кэшируется до следующего add
+		const std::string& helpText() const;
+		// зарегистрированные аргументы в порядке добавления
+		const std::vector<Arg*>& args() const { return args_; }
+		// поиск аргумента по точному длинному или короткому имени, nullptr если не найден
+		Arg* findByLongName(std::string_view longName) const;
+		Arg* findByShortName(char shortName) const;
 		// обработка командной строки
 		void parse(int argc, const char** argv);
 		// вспомогательный метод для parse для добавление значений к аргументам
@@ -162,100 +635,146 @@ namespace args_parse {
 		// вспомогательный метод для parse для добавление значений к аргументам со знаком равно
 		void executeEquals(Arg* arg, const std::string_view& value);
 
+		// список ошибок, накопленных при добавлении аргументов и последнем разборе командной строки
+		const std::vector<Diagnostic>& diagnostics() const { return diagnostics_; }
+		// установка приемника ошибок; пустой приемник только накапливает ошибки в списке
+		void setDiagnosticSink(DiagnosticSink sink) { sink_ = std::move(sink); }
+
+		// значения аргументов, отсутствующих в командной строке, берутся из переменных PREFIX_LONG_NAME
+		void setEnvPrefix(const std::string& prefix) { environment_ = EnvironmentSource(prefix); }
+		// затем из конфигурационного файла с ключами по длинным именам
+		void setConfigFile(const std::string& path) { configFile_ = std::make_unique<ConfigFile>(path); }
+
+		// разрешение однозначных сокращений длинных имен (--thr вместо --threads), включено по умолчанию
+		void setAllowAbbreviations(bool allow) { allowAbbreviations_ = allow; }
+
+		// группа взаимоисключающих аргументов: после разбора допустим не более чем один из них
+		void addExclusiveGroup(const std::vector<const Arg*>& group) { exclusiveGroups_.push_back(group); }
+
 	private:
+		friend class BatchParser;
+
+		// регистрация ошибки в списке и передача ее в приемник
+		void report(ErrorCode code, std::string argument, std::string_view token = {});
+		// регистрация ошибки значения, если setValue ее вернул
+		void reportValue(const Arg* arg, ErrorCode code, const std::string_view& value);
+
+		// формирование текста справки
+		std::string renderHelp() const;
+		// поиск аргумента по длинному имени или его сокращению; при неудаче регистрирует ошибку
+		Arg* findLong(const std::string_view& longName);
+		// префиксное дерево длинных имен, строится при первом обращении после add
+		const NameTree& nameTree();
+		// заполнение аргументов, не заданных в командной строке, из окружения и конфигурационного файла
+		void resolveSources();
+		// аргумент из командной строки важнее значений по умолчанию для его взаимоисключающих соседей
+		bool exclusivePeerGiven(const Arg* arg) const;
+		// проверка обязательных и взаимоисключающих аргументов после разбора
+		void checkConstraints();
+
 		std::unordered_map<char, Arg*> shortNameArgs_;
 		std::unordered_map<std::string_view, Arg*> longNameArgs_;
+		// аргументы в порядке добавления, для детерминированной справки
+		std::vector<Arg*> args_;
+		// кэш текста справки
+		mutable std::string helpCache_;
+		mutable bool helpCached_ = false;
+		// сумма Arg::revision() на момент формирования кэша; счетчики только растут, поэтому любое изменение ее меняет
+		mutable uint64_t helpRevision_ = 0;
+		// префиксное дерево длинных имен, идентификаторы - индексы в args_
+		NameTree nameTree_;
+		bool nameTreeBuilt_ = false;
+		bool allowAbbreviations_ = true;
+		// аргументы, получившие значение из командной строки при последнем parse
+		std::unordered_set<const Arg*> given_;
+		EnvironmentSource environment_;
+		std::unique_ptr<ConfigFile> configFile_;
+		std::vector<std::vector<const Arg*>> exclusiveGroups_;
+		std::vector<Diagnostic> diagnostics_;
+		// ошибки, накопленные в add; остаются в diagnostics_ после каждого parse
+		std::vector<Diagnostic> setupDiagnostics_;
+		DiagnosticSink sink_ = writeDiagnosticToStderr;
 	};
 	// Специализация шаблонов метода setValue для различных типов данных
 	template<>
-	inline void SingleArg<int>::setValue(const std::string_view& value) {
-		try {
-			value_ = std::stoi(std::string(value));
-			defined_ = true;
-		}
-		catch (...) {
-			std::cerr << "Error: Invalid integer value: " << value << std::endl;
-		}
+	inline ErrorCode SingleArg<int>::convert(const std::string_view& value, int& out) const {
+		if (!ParseNumber(value, out))
+			return ErrorCode::InvalidValue;
+		return constraints_.check(out);
 	}
 
 	template<>
-	inline void SingleArg<float>::setValue(const std::string_view& value) {
-		try {
-			value_ = std::stof(std::string(value));
-			defined_ = true;
-		}
-		catch (...) {
-			std::cerr << "Error: Invalid float value: " << value << std::endl;
-		}
+	inline ErrorCode SingleArg<float>::convert(const std::string_view& value, float& out) const {
+		if (!ParseNumber(value, out))
+			return ErrorCode::InvalidValue;
+		return constraints_.check(out);
 	}
 
 	template<>
-	inline void SingleArg<bool>::setValue(const std::string_view& value) {
-		if (std::string(value) == "true" || std::string(value) == "1")
-		{
-			value_ = true;
-			defined_ = true;
-		}
-
-		else if (std::string(value) == "false" || std::string(value) == "0")
-		{
-			value_ = false;
-			defined_ = true;
-		}
+	inline ErrorCode SingleArg<bool>::convert(const std::string_view& value, bool& out) const {
+		if (value == "true" || value == "1")
+			out = true;
+		else if (value == "false" || value == "0")
+			out = false;
 		else
-			std::cerr << "Error: Invalid boolean value: " << value << std::endl;
+			return ErrorCode::InvalidValue;
+		return ErrorCode::None;
 	}
 
 	template<>
-	inline void SingleArg<std::string>::setValue(const std::string_view& value) {
-		value_ = value;
-		defined_ = true;
+	inline ErrorCode SingleArg<std::string>::convert(const std::string_view& value, std::string& out) const {
+		// ограничения проверяются до копирования строки
+		if (ErrorCode code = constraints_.check(value); code != ErrorCode::None)
+			return code;
+		out = value;
+		return ErrorCode::None;
 	}
 
 	template<>
-	inline void SingleArg<UserChrono>::setValue(const std::string_view& value) {
-		UserChrono tempChrono;
-		if (ParseUserChrono(tempChrono, value)) {
-			value_ = tempChrono;
-			defined_ = true;
-		}
-		else {
-			std::cerr << "Error: Invalid UserChrono value: " << value << std::endl;
-		}
+	inline ErrorCode SingleArg<UserChrono>::convert(const std::string_view& value, UserChrono& out) const {
+		return ParseUserChrono(out, value) ? ErrorCode::None : ErrorCode::InvalidValue;
 	}
 
 	template<>
-	inline void MultiArg<int>::setValue(const std::string_view& value) {
-		try {
-			values_.push_back(std::stoi(std::string(value)));
-		}
-		catch (...) {
-			std::cerr << "Error: Invalid int value: " << value << std::endl;
+	inline ErrorCode MultiArg<int>::convert(const std::string_view& value, std::vector<int>& out, std::vector<IntRange>* ranges) const {
+		// список 1,2,3 и диапазоны 0-4095 разбираются и проверяются за один проход; при ошибке откатываем весь токен
+		const size_t valuesSize = out.size();
+		const size_t rangesSize = ranges ? ranges->size() : 0;
+		ErrorCode code = ParseNumberList(value, out, ranges, [this](int number) { return constraints_.check(number); });
+		if (code != ErrorCode::None) {
+			out.resize(valuesSize);
+			if (ranges)
+				ranges->erase(ranges->begin() + rangesSize, ranges->end());
 		}
+		return code;
 	}
 
 	template<>
-	inline void MultiArg<float>::setValue(const std::string_view& value) {
-		try {
-			values_.push_back(std::stof(std::string(value)));
-		}
-		catch (...) {
-			std::cerr << "Error: Invalid float value: " << value << std::endl;
-		}
+	inline ErrorCode MultiArg<float>::convert(const std::string_view& value, std::vector<float>& out, std::vector<IntRange>*) const {
+		// список 1.5,2.5 разбирается и проверяется за один проход; при ошибке откатываем весь токен
+		const size_t valuesSize = out.size();
+		ErrorCode code = ParseNumberList(value, out, nullptr, [this](float number) { return constraints_.check(number); });
+		if (code != ErrorCode::None)
+			out.resize(valuesSize);
+		return code;
 	}
 
 	template<>
-	inline void MultiArg<bool>::setValue(const std::string_view& value) {
+	inline ErrorCode MultiArg<bool>::convert(const std::string_view& value, std::vector<bool>& out, std::vector<IntRange>*) const {
 		if (value == "true" || value == "1")
-			values_.push_back(true);
+			out.push_back(true);
 		else if (value == "false" || value == "0")
-			values_.push_back(false);
+			out.push_back(false);
 		else
-			std::cerr << "Error: Invalid boolean value: " << value << std::endl;
+			return ErrorCode::InvalidValue;
+		return ErrorCode::None;
 	}
 
 	template<>
-	inline void MultiArg<std::string>::setValue(const std::string_view& value) {
-		values_.push_back(std::string(value));
+	inline ErrorCode MultiArg<std::string>::convert(const std::string_view& value, std::vector<std::string>& out, std::vector<IntRange>*) const {
+		if (ErrorCode code = constraints_.check(value); code != ErrorCode::None)
+			return code;
+		out.push_back(std::string(value));
+		return ErrorCode::None;
 	}
 } // namespace args_parse
\ No newline at end of file
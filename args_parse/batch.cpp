@@ -0,0 +1,256 @@
+﻿#include "batch.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace args_parse {
+	struct BatchParser::Chunk {
+		// первая строка блока и количество строк
+		size_t first = 0;
+		size_t rows = 0;
+		// для каждого аргумента: значения всех строк блока подряд и количество значений в каждой строке
+		std::vector<ValueColumn> values;
+		std::vector<std::vector<uint32_t>> counts;
+		std::vector<BatchError> errors;
+	};
+
+	/// @brief метка типа для выбора типизированной ветки по ValueType
+	template<typename T>
+	struct TypeTag {
+		using Type = T;
+	};
+
+	/// @brief вызвать f с меткой типа, соответствующей ValueType
+	template<typename F>
+	static void dispatchType(ValueType type, F&& f) {
+		switch (type) {
+		case ValueType::Bool: f(TypeTag<bool>{}); break;
+		case ValueType::Int: f(TypeTag<int>{}); break;
+		case ValueType::Float: f(TypeTag<float>{}); break;
+		case ValueType::String: f(TypeTag<std::string>{}); break;
+		case ValueType::Chrono: f(TypeTag<UserChrono>{}); break;
+		case ValueType::Unknown: break;
+		}
+	}
+
+	/// @brief найти столбец по длинному имени
+	const BatchColumn* BatchResult::column(std::string_view longName) const {
+		for (const auto& column : columns) {
+			if (column.arg()->longName() == longName)
+				return &column;
+		}
+		return nullptr;
+	}
+
+	/// @brief подготовить таблицы имен; префиксное дерево парсера строится здесь, до запуска потоков
+	BatchParser::BatchParser(ArgsParser& parser) : parser_(parser), args_(parser.args_) {
+		for (size_t i = 0; i < args_.size(); ++i) {
+			if (args_[i]->shortName() != '\0')
+				shortNames_[args_[i]->shortName()] = static_cast<int>(i);
+			if (!args_[i]->longName().empty())
+				longNames_[args_[i]->longName()] = static_cast<int>(i);
+		}
+		parser_.nameTree();
+		for (const auto& group : parser_.exclusiveGroups_) {
+			std::vector<int> indexes;
+			for (const Arg* arg : group) {
+				auto iter = std::find(args_.begin(), args_.end(), arg);
+				if (iter != args_.end())
+					indexes.push_back(static_cast<int>(iter - args_.begin()));
+			}
+			exclusiveGroups_.push_back(std::move(indexes));
+		}
+	}
+
+	/// @brief разобрать командные строки в формате argv
+	BatchResult BatchParser::parse(const std::vector<std::vector<const char*>>& commandLines, size_t threads) const {
+		std::vector<std::vector<std::string_view>> lines(commandLines.size());
+		for (size_t row = 0; row < commandLines.size(); ++row) {
+			const auto& argv = commandLines[row];
+			if (argv.size() > 1)
+				lines[row].assign(argv.begin() + 1, argv.end());
+		}
+		return run(lines, threads);
+	}
+
+	/// @brief разобрать буфер командных строк
+	BatchResult BatchParser::parse(std::string_view buffer, size_t threads) const {
+		std::vector<std::vector<std::string_view>> lines;
+		while (!buffer.empty()) {
+			const size_t lineEnd = buffer.find('\n');
+			std::string_view line = buffer.substr(0, lineEnd);
+			buffer.remove_prefix(lineEnd == std::string_view::npos ? buffer.size() : lineEnd + 1);
+
+			auto& tokens = lines.emplace_back();
+			size_t pos = 0;
+			while (pos < line.size()) {
+				const size_t begin = line.find_first_not_of(" \t\r", pos);
+				if (begin == std::string_view::npos)
+					break;
+				const size_t end = std::min(line.find_first_of(" \t\r", begin), line.size());
+				tokens.push_back(line.substr(begin, end - begin));
+				pos = end;
+			}
+		}
+		return run(lines, threads);
+	}
+
+	/// @brief раздать блоки строк потокам и объединить результаты
+	BatchResult BatchParser::run(const std::vector<std::vector<std::string_view>>& lines, size_t threads) const {
+		const size_t rows = lines.size();
+		if (threads == 0)
+			threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+		// битовые карты заполняет последовательное объединение, поэтому границы блоков произвольные;
+		// нижняя граница в 64 строки лишь не дает запускать поток ради нескольких строк
+		size_t chunkRows = (rows + threads - 1) / std::max<size_t>(threads, 1);
+		chunkRows = std::max<size_t>(64, chunkRows);
+		const size_t chunkCount = (rows + chunkRows - 1) / chunkRows;
+
+		std::vector<Chunk> chunks(chunkCount);
+		std::vector<std::thread> workers;
+		for (size_t c = 0; c < chunkCount; ++c) {
+			const size_t first = c * chunkRows;
+			const size_t last = std::min(rows, first + chunkRows);
+			if (c + 1 == chunkCount)
+				parseChunk(lines, first, last, chunks[c]);
+			else
+				workers.emplace_back([&, first, last, c] { parseChunk(lines, first, last, chunks[c]); });
+		}
+		for (auto& worker : workers)
+			worker.join();
+		return merge(chunks, rows);
+	}
+
+	/// @brief разобрать блок строк
+	void BatchParser::parseChunk(const std::vector<std::vector<std::string_view>>& lines, size_t first, size_t last, Chunk& chunk) const {
+		chunk.first = first;
+		chunk.rows = last - first;
+		chunk.values.resize(args_.size());
+		chunk.counts.assign(args_.size(), std::vector<uint32_t>(chunk.rows, 0));
+		for (size_t row = first; row < last; ++row)
+			parseLine(lines[row], row, chunk);
+	}
+
+	/// @brief найти аргумент по короткому имени
+	int BatchParser::findShort(char name, size_t row, Chunk& chunk) const {
+		auto iter = shortNames_.find(name);
+		if (iter != shortNames_.end())
+			return iter->second;
+		chunk.errors.push_back(BatchError{ row, Diagnostic{ ErrorCode::UnknownArgument, std::string("-") + name, {} } });
+		return -1;
+	}
+
+	/// @brief найти аргумент по длинному имени или однозначному сокращению
+	int BatchParser::findLong(std::string_view name, size_t row, Chunk& chunk) const {
+		auto iter = longNames_.find(name);
+		if (iter != longNames_.end())
+			return iter->second;
+		int id = NameTree::NotFound;
+		if (parser_.allowAbbreviations_)
+			id = parser_.nameTree_.resolvePrefix(name);
+		if (id >= 0)
+			return id;
+		const ErrorCode code = id == NameTree::Ambiguous ? ErrorCode::AmbiguousArgument : ErrorCode::UnknownArgument;
+		chunk.errors.push_back(BatchError{ row, Diagnostic{ code, "--" + std::string(name), {} } });
+		return -1;
+	}
+
+	/// @brief разобрать одну командную строку по тем же правилам, что и ArgsParser::parse
+	void BatchParser::parseLine(const std::vector<std::string_view>& tokens, size_t row, Chunk& chunk) const {
+		const size_t local = row - chunk.first;
+		auto decode = [&](int index, std::string_view value) {
+			ValueColumn& column = chunk.values[index];
+			const size_t before = column.size();
+			const ErrorCode code = args_[index]->decode(value, column);
+			if (code != ErrorCode::None)
+				chunk.errors.push_back(BatchError{ row, Diagnostic{ code, args_[index]->displayName(), std::string(value) } });
+			chunk.counts[index][local] += static_cast<uint32_t>(column.size() - before);
+		};
+
+		for (size_t i = 0; i < tokens.size(); ++i) {
+			const std::string_view arg = tokens[i];
+			if (arg.size() < 2 || arg[0] != '-')
+				continue;
+			int index;
+			const size_t equalPos = arg.find('=');
+			if (arg[1] == '-') {
+				if (equalPos != std::string_view::npos) {
+					if ((index = findLong(arg.substr(2, equalPos - 2), row, chunk)) >= 0)
+						decode(index, arg.substr(equalPos + 1));
+					continue;
+				}
+				index = findLong(arg.substr(2), row, chunk);
+			}
+			else {
+				index = findShort(arg[1], row, chunk);
+				if (equalPos != std::string_view::npos || arg.size() > 2) {
+					if (index >= 0)
+						decode(index, arg.substr(equalPos != std::string_view::npos ? equalPos + 1 : 2));
+					continue;
+				}
+			}
+			// значения идут следующими элементами
+			while (i + 1 < tokens.size() && !tokens[i + 1].empty() && tokens[i + 1][0] != '-') {
+				++i;
+				if (index >= 0)
+					decode(index, tokens[i]);
+			}
+		}
+
+		for (size_t a = 0; a < args_.size(); ++a) {
+			if (args_[a]->isRequired() && chunk.counts[a][local] == 0)
+				chunk.errors.push_back(BatchError{ row, Diagnostic{ ErrorCode::MissingRequired, args_[a]->displayName(), {} } });
+		}
+		for (const auto& group : exclusiveGroups_) {
+			int first = -1;
+			for (int a : group) {
+				if (chunk.counts[a][local] == 0)
+					continue;
+				if (first < 0)
+					first = a;
+				else
+					chunk.errors.push_back(BatchError{ row, Diagnostic{ ErrorCode::MutuallyExclusive, args_[a]->displayName(), args_[first]->displayName() } });
+			}
+		}
+	}
+
+	/// @brief объединить блоки: битовые карты, границы строк и значения каждого аргумента
+	BatchResult BatchParser::merge(std::vector<Chunk>& chunks, size_t rows) const {
+		BatchResult result;
+		result.rows = rows;
+		result.columns.reserve(args_.size());
+		for (size_t a = 0; a < args_.size(); ++a) {
+			BatchColumn& column = result.columns.emplace_back(args_[a]);
+			column.presence_.assign((rows + 63) / 64, 0);
+			const bool multi = args_[a]->isMulti();
+			if (multi)
+				column.offsets_.assign(1, 0);
+
+			dispatchType(args_[a]->valueType(), [&](auto tag) {
+				using T = typename decltype(tag)::Type;
+				std::vector<T>& out = column.values_.values<T>();
+				out.reserve(multi ? 0 : rows);
+				for (Chunk& chunk : chunks) {
+					const std::vector<T>& in = chunk.values[a].values<T>();
+					const std::vector<uint32_t>& counts = chunk.counts[a];
+					size_t pos = 0;
+					for (size_t local = 0; local < chunk.rows; ++local) {
+						const size_t row = chunk.first + local;
+						pos += counts[local];
+						if (counts[local] != 0)
+							column.presence_[row / 64] |= uint64_t(1) << (row % 64);
+						if (multi)
+							column.offsets_.push_back(static_cast<uint32_t>(column.offsets_.back() + counts[local]));
+						else
+							out.push_back(counts[local] != 0 ? T(in[pos - 1]) : T{});
+					}
+					if (multi)
+						out.insert(out.end(), in.begin(), in.end());
+				}
+			});
+		}
+		for (Chunk& chunk : chunks)
+			result.errors.insert(result.errors.end(), std::make_move_iterator(chunk.errors.begin()), std::make_move_iterator(chunk.errors.end()));
+		return result;
+	}
+} // namespace args_parse
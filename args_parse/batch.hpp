@@ -0,0 +1,93 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "args.hpp"
+
+namespace args_parse {
+	/// @brief Ошибка пакетного разбора: номер командной строки и описание ошибки
+	struct BatchError {
+		size_t row;
+		Diagnostic diagnostic;
+	};
+
+	/// @brief Столбец результатов пакетного разбора для одного аргумента
+	/// Для одиночного аргумента в столбце ровно по одному значению на строку (T{} для отсутствующих),
+	/// для множественного - значения всех строк подряд, значения строки row лежат в [offsets[row], offsets[row + 1]).
+	class BatchColumn {
+	public:
+		BatchColumn(const Arg* arg) : arg_(arg) {}
+
+		// аргумент, которому соответствует столбец
+		const Arg* arg() const { return arg_; }
+		// значения столбца
+		template<typename T>
+		const std::vector<T>& values() const { return values_.values<T>(); }
+		// границы значений по строкам, только для множественных аргументов
+		const std::vector<uint32_t>& offsets() const { return offsets_; }
+		// битовая карта строк, в которых аргумент задан: бит row % 64 слова row / 64
+		const std::vector<uint64_t>& presence() const { return presence_; }
+		// аргумент задан в строке row
+		bool isPresent(size_t row) const { return (presence_[row / 64] >> (row % 64)) & 1; }
+
+	private:
+		friend class BatchParser;
+
+		const Arg* arg_;
+		ValueColumn values_;
+		std::vector<uint32_t> offsets_;
+		std::vector<uint64_t> presence_;
+	};
+
+	/// @brief Результат пакетного разбора: по столбцу на каждый аргумент в порядке добавления в парсер
+	struct BatchResult {
+		size_t rows = 0;
+		std::vector<BatchColumn> columns;
+		// ошибки в порядке возрастания номера строки
+		std::vector<BatchError> errors;
+
+		// столбец по длинному имени аргумента или nullptr
+		const BatchColumn* column(std::string_view longName) const;
+	};
+
+	/// @brief Пакетный разбор множества командных строк по набору аргументов ArgsParser
+	/// Значения преобразуются методом Arg::decode, который не меняет аргументы, поэтому строки
+	/// разбираются параллельно. Каждый поток обрабатывает свой блок строк, затем блоки
+	/// последовательно объединяются в столбцы вместе с битовыми картами присутствия.
+	class BatchParser {
+	public:
+		// набор аргументов берется из парсера; парсер не должен меняться, пока используется BatchParser
+		explicit BatchParser(ArgsParser& parser);
+
+		// разбор командных строк; argv[0] каждой строки - имя программы, как в ArgsParser::parse;
+		// threads = 0 - по числу ядер
+		BatchResult parse(const std::vector<std::vector<const char*>>& commandLines, size_t threads = 0) const;
+		// разбор буфера, в котором командные строки разделены переводом строки, а элементы - пробелами;
+		// имени программы в строках нет
+		BatchResult parse(std::string_view buffer, size_t threads = 0) const;
+
+	private:
+		/// @brief Результаты одного блока строк
+		struct Chunk;
+
+		// разбор строк [first, last) в блок
+		void parseChunk(const std::vector<std::vector<std::string_view>>& lines, size_t first, size_t last, Chunk& chunk) const;
+		// разбор одной командной строки
+		void parseLine(const std::vector<std::string_view>& tokens, size_t row, Chunk& chunk) const;
+		// аргумент по имени; при ошибке регистрирует ее в блоке
+		int findShort(char name, size_t row, Chunk& chunk) const;
+		int findLong(std::string_view name, size_t row, Chunk& chunk) const;
+		// объединение блоков в столбцы
+		BatchResult merge(std::vector<Chunk>& chunks, size_t rows) const;
+		BatchResult run(const std::vector<std::vector<std::string_view>>& lines, size_t threads) const;
+
+		ArgsParser& parser_;
+		const std::vector<Arg*>& args_;
+		std::unordered_map<char, int> shortNames_;
+		std::unordered_map<std::string_view, int> longNames_;
+		std::vector<std::vector<int>> exclusiveGroups_;
+	};
+} // namespace args_parse
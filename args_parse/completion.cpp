@@ -0,0 +1,320 @@
+﻿#include "completion.hpp"
+#include "args.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <climits>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace args_parse {
+	/// @brief дописать в буфер двоичное представление структуры
+	template<typename T>
+	static void appendRaw(std::string& out, const T& value) {
+		out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	/// @brief сформировать таблицу: записи сортируются по длинному имени для двоичного поиска по префиксу
+	std::string buildCompletionTable(const ArgsParser& parser) {
+		std::vector<const Arg*> args(parser.args().begin(), parser.args().end());
+		std::stable_sort(args.begin(), args.end(),
+			[](const Arg* left, const Arg* right) { return left->longName() < right->longName(); });
+
+		std::string strings;
+		auto addString = [&](const std::string& value) {
+			CompletionString ref{ static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(value.size()) };
+			strings += value;
+			return ref;
+		};
+
+		std::vector<CompletionEntry> entries;
+		std::vector<CompletionString> choices;
+		entries.reserve(args.size());
+		for (const Arg* arg : args) {
+			CompletionEntry entry{};
+			entry.longName = addString(arg->longName());
+			entry.shortName = arg->shortName();
+			entry.valueType = static_cast<uint8_t>(arg->valueType());
+			entry.multi = arg->isMulti() ? 1 : 0;
+			entry.choicesFirst = static_cast<uint32_t>(choices.size());
+			for (const auto& choice : arg->choices().choices())
+				choices.push_back(addString(choice));
+			entry.choicesCount = static_cast<uint32_t>(choices.size()) - entry.choicesFirst;
+			entries.push_back(entry);
+		}
+
+		CompletionHeader header{};
+		std::memcpy(header.magic, CompletionMagic, sizeof(header.magic));
+		header.version = CompletionVersion;
+		header.entryCount = static_cast<uint32_t>(entries.size());
+		header.choiceCount = static_cast<uint32_t>(choices.size());
+		header.stringsSize = static_cast<uint32_t>(strings.size());
+
+		std::string table;
+		table.reserve(sizeof(header) + entries.size() * sizeof(CompletionEntry) + choices.size() * sizeof(CompletionString) + strings.size());
+		appendRaw(table, header);
+		for (const auto& entry : entries)
+			appendRaw(table, entry);
+		for (const auto& choice : choices)
+			appendRaw(table, choice);
+		table += strings;
+		return table;
+	}
+
+	/// @brief сохранить таблицу в файл
+	bool saveCompletionTable(const ArgsParser& parser, const std::string& path) {
+		const std::string table = buildCompletionTable(parser);
+		std::FILE* file = std::fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+		const bool written = std::fwrite(table.data(), 1, table.size(), file) == table.size();
+		return std::fclose(file) == 0 && written;
+	}
+
+	/// @brief скрипт для bash
+	std::string bashCompletionScript(const std::string& program) {
+		std::string function = "_";
+		for (char c : program)
+			function += (c == '-' || c == '.') ? '_' : c;
+		function += "_complete";
+		// COMP_WORDS разбиты по COMP_WORDBREAKS, куда входит '=', поэтому слова берутся из COMP_LINE;
+		// bash заменяет только часть слова после последнего '=', и префикс --name= из вариантов убирается
+		return function + "() {\n"
+			"    local line=\"${COMP_LINE:0:COMP_POINT}\" cur=\"\" prev=\"\"\n"
+			"    local -a words\n"
+			"    read -ra words <<< \"$line\"\n"
+			"    local count=${#words[@]}\n"
+			"    if [[ \"$line\" == *[[:space:]] ]]; then\n"
+			"        (( count > 0 )) && prev=\"${words[count-1]}\"\n"
+			"    else\n"
+			"        (( count > 0 )) && cur=\"${words[count-1]}\"\n"
+			"        (( count > 1 )) && prev=\"${words[count-2]}\"\n"
+			"    fi\n"
+			"    local IFS=$'\\n'\n"
+			"    COMPREPLY=( $(" + program + " --complete \"$prev\" \"$cur\" 2>/dev/null) )\n"
+			"    if [[ \"$cur\" == *=* && \"$COMP_WORDBREAKS\" == *=* ]]; then\n"
+			"        local strip=\"${cur%=*}=\"\n"
+			"        COMPREPLY=( \"${COMPREPLY[@]#\"$strip\"}\" )\n"
+			"    fi\n"
+			"}\n"
+			"complete -F " + function + " " + program + "\n";
+	}
+
+	/// @brief скрипт для zsh
+	std::string zshCompletionScript(const std::string& program) {
+		std::string function = "_";
+		for (char c : program)
+			function += (c == '-' || c == '.') ? '_' : c;
+		return "#compdef " + program + "\n"
+			+ function + "() {\n"
+			"    local -a candidates\n"
+			// без кавычек вокруг ${(f)...} пустой вывод не превращается в один пустой вариант
+			"    candidates=( ${(f)\"$(" + program + " --complete \"${words[CURRENT-1]}\" \"${words[CURRENT]}\" 2>/dev/null)\"} )\n"
+			"    (( ${#candidates} )) && compadd -Q -- $candidates\n"
+			"}\n"
+			"compdef " + function + " " + program + "\n";
+	}
+
+	/// @brief открыть таблицу и проверить, что разделы и все ссылки на строки и значения не выходят за пределы файла
+	bool CompletionIndex::open(const std::string& path) {
+		entries_ = nullptr;
+		choices_ = nullptr;
+		entryCount_ = choiceCount_ = 0;
+		strings_ = {};
+		if (!file_.open(path))
+			return false;
+		return attach(file_.content());
+	}
+
+	/// @brief принять таблицу из памяти; буфер std::string выровнен не хуже, чем нужно разделам таблицы
+	bool CompletionIndex::assign(std::string table) {
+		file_.close();
+		table_ = std::move(table);
+		return attach(table_);
+	}
+
+	/// @brief разобрать таблицу
+	bool CompletionIndex::attach(std::string_view content) {
+		entries_ = nullptr;
+		choices_ = nullptr;
+		entryCount_ = choiceCount_ = 0;
+		strings_ = {};
+		CompletionHeader header;
+		if (content.size() < sizeof(header))
+			return false;
+		std::memcpy(&header, content.data(), sizeof(header));
+		if (std::memcmp(header.magic, CompletionMagic, sizeof(header.magic)) != 0 || header.version != CompletionVersion)
+			return false;
+		const size_t entriesSize = static_cast<size_t>(header.entryCount) * sizeof(CompletionEntry);
+		const size_t choicesSize = static_cast<size_t>(header.choiceCount) * sizeof(CompletionString);
+		if (content.size() != sizeof(header) + entriesSize + choicesSize + header.stringsSize)
+			return false;
+		// разделы выровнены на 4 байта относительно начала файла, а начало отображения выровнено на страницу
+		const auto* entries = reinterpret_cast<const CompletionEntry*>(content.data() + sizeof(header));
+		const auto* choices = reinterpret_cast<const CompletionString*>(content.data() + sizeof(header) + entriesSize);
+		// все ссылки проверяются один раз при открытии, дальше text() и choices_[i] не выходят за границы;
+		// сумма считается в 64 битах, чтобы offset + size не переполнялся
+		auto validString = [&](const CompletionString& ref) {
+			return static_cast<uint64_t>(ref.offset) + ref.size <= header.stringsSize;
+		};
+		for (uint32_t i = 0; i < header.choiceCount; ++i) {
+			if (!validString(choices[i]))
+				return false;
+		}
+		const std::string_view strings = content.substr(sizeof(header) + entriesSize + choicesSize);
+		for (uint32_t i = 0; i < header.entryCount; ++i) {
+			const CompletionEntry& entry = entries[i];
+			if (!validString(entry.longName)
+				|| static_cast<uint64_t>(entry.choicesFirst) + entry.choicesCount > header.choiceCount)
+				return false;
+			// двоичный поиск в findOption требует сортировки по длинному имени
+			if (i > 0 && strings.substr(entry.longName.offset, entry.longName.size)
+				< strings.substr(entries[i - 1].longName.offset, entries[i - 1].longName.size))
+				return false;
+		}
+		entries_ = entries;
+		choices_ = choices;
+		strings_ = strings;
+		entryCount_ = header.entryCount;
+		choiceCount_ = header.choiceCount;
+		return true;
+	}
+
+	/// @brief найти аргумент по слову командной строки
+	const CompletionEntry* CompletionIndex::findOption(std::string_view word) const {
+		if (word.size() > 2 && word[0] == '-' && word[1] == '-') {
+			const std::string_view name = word.substr(2);
+			const CompletionEntry* last = entries_ + entryCount_;
+			const CompletionEntry* entry = std::lower_bound(entries_, last, name,
+				[&](const CompletionEntry& e, std::string_view value) { return text(e.longName) < value; });
+			if (entry != last && text(entry->longName) == name)
+				return entry;
+		}
+		else if (word.size() == 2 && word[0] == '-') {
+			for (uint32_t i = 0; i < entryCount_; ++i) {
+				if (entries_[i].shortName == word[1] && word[1] != '\0')
+					return &entries_[i];
+			}
+		}
+		return nullptr;
+	}
+
+	/// @brief дополнить значение аргумента по списку допустимых значений
+	void CompletionIndex::completeValues(const CompletionEntry& entry, std::string_view prefix, std::string_view prepend, std::vector<std::string>& result) const {
+		auto add = [&](std::string_view value) {
+			if (value.substr(0, prefix.size()) == prefix)
+				result.push_back(std::string(prepend) + std::string(value));
+		};
+		if (static_cast<ValueType>(entry.valueType) == ValueType::Bool) {
+			add("true");
+			add("false");
+			return;
+		}
+		// границы диапазона проверены в open
+		const uint32_t last = entry.choicesFirst + entry.choicesCount;
+		for (uint32_t i = entry.choicesFirst; i < last; ++i)
+			add(text(choices_[i]));
+	}
+
+	/// @brief варианты дополнения: значения после аргумента, значения после --name=, имена аргументов
+	std::vector<std::string> CompletionIndex::complete(std::string_view previous, std::string_view current) const {
+		std::vector<std::string> result;
+		if (!entries_)
+			return result;
+
+		// значение в виде --name=prefix
+		const size_t equalPos = current.find('=');
+		if (current.size() > 2 && current[0] == '-' && current[1] == '-' && equalPos != std::string_view::npos) {
+			if (const CompletionEntry* entry = findOption(current.substr(0, equalPos)))
+				completeValues(*entry, current.substr(equalPos + 1), current.substr(0, equalPos + 1), result);
+			return result;
+		}
+		// значение после имени аргумента
+		if (current.empty() || current[0] != '-') {
+			if (const CompletionEntry* entry = findOption(previous))
+				completeValues(*entry, current, {}, result);
+			return result;
+		}
+		// имена аргументов: длинные имена с нужным префиксом лежат подряд
+		if (current.size() >= 2 && current[1] == '-') {
+			const std::string_view prefix = current.substr(2);
+			const CompletionEntry* last = entries_ + entryCount_;
+			const CompletionEntry* entry = std::lower_bound(entries_, last, prefix,
+				[&](const CompletionEntry& e, std::string_view value) { return text(e.longName) < value; });
+			for (; entry != last && text(entry->longName).substr(0, prefix.size()) == prefix; ++entry) {
+				if (entry->longName.size != 0)
+					result.push_back("--" + std::string(text(entry->longName)));
+			}
+			return result;
+		}
+		// "-": короткие имена
+		for (uint32_t i = 0; i < entryCount_; ++i) {
+			if (entries_[i].shortName != '\0')
+				result.push_back(std::string("-") + entries_[i].shortName);
+		}
+		return result;
+	}
+
+	/// @brief путь таблицы рядом с исполняемым файлом
+	std::string completionIndexPath(const char* argv0) {
+#ifndef _WIN32
+		char buffer[PATH_MAX];
+		const ssize_t length = readlink("/proc/self/exe", buffer, sizeof(buffer) - 1);
+		if (length > 0)
+			return std::string(buffer, static_cast<size_t>(length)) + ".complete";
+#endif
+		return std::string(argv0 ? argv0 : "") + ".complete";
+	}
+
+	/// @brief таблица не старше исполняемого файла; если время изменения не узнать, таблица считается актуальной
+	static bool indexUpToDate(const std::string& path) {
+#ifndef _WIN32
+		struct stat index;
+		struct stat program;
+		if (stat(path.c_str(), &index) == 0 && stat("/proc/self/exe", &program) == 0)
+			return index.st_mtime >= program.st_mtime;
+#else
+		(void)path;
+#endif
+		return true;
+	}
+
+	/// @brief вывести варианты для слов argv[2], argv[3]
+	static void printCompletions(const CompletionIndex& index, int argc, const char** argv) {
+		const std::string_view previous = argc > 3 ? argv[2] : "";
+		const std::string_view current = argc > 3 ? argv[3] : (argc > 2 ? argv[2] : "");
+		std::string output;
+		for (const auto& candidate : index.complete(previous, current)) {
+			output += candidate;
+			output += '\n';
+		}
+		writeAll(1, output);
+	}
+
+	/// @brief быстрый путь: ответить по таблице, не создавая аргументов
+	bool completeFromIndex(int argc, const char** argv, const std::string& indexPath) {
+		if (argc < 2 || std::strcmp(argv[1], "--complete") != 0)
+			return false;
+		const std::string path = indexPath.empty() ? completionIndexPath(argv[0]) : indexPath;
+		// устаревшая таблица может не знать новых аргументов, тогда отвечает completeFromParser
+		CompletionIndex index;
+		if (!indexUpToDate(path) || !index.open(path))
+			return false;
+		printCompletions(index, argc, argv);
+		return true;
+	}
+
+	/// @brief медленный путь: таблица строится в памяти по зарегистрированным аргументам
+	bool completeFromParser(const ArgsParser& parser, int argc, const char** argv) {
+		if (argc < 2 || std::strcmp(argv[1], "--complete") != 0)
+			return false;
+		CompletionIndex index;
+		if (index.assign(buildCompletionTable(parser)))
+			printCompletions(index, argc, argv);
+		return true;
+	}
+} // namespace args_parse
@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include "mapped_file.hpp"
+
+namespace args_parse {
+	class ArgsParser;
+
+	/// @brief Двоичная таблица автодополнения
+	/// Формат (все поля в порядке байтов машины, смещения от начала таблицы, поэтому таблицу можно отображать в память):
+	///   CompletionHeader, затем CompletionEntry[entryCount] отсортированные по длинному имени,
+	///   CompletionString[choiceCount] допустимых значений, затем общий буфер строк.
+	struct CompletionHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t choiceCount;
+		uint32_t stringsSize;
+	};
+
+	/// @brief Ссылка на строку в буфере строк таблицы
+	struct CompletionString {
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	/// @brief Описание одного аргумента в таблице автодополнения
+	struct CompletionEntry {
+		CompletionString longName;
+		// диапазон допустимых значений в массиве CompletionString
+		uint32_t choicesFirst;
+		uint32_t choicesCount;
+		char shortName;
+		// ValueType
+		uint8_t valueType;
+		uint8_t multi;
+		uint8_t reserved;
+	};
+
+	// сигнатура и версия формата таблицы
+	constexpr char CompletionMagic[4] = { 'A', 'P', 'C', 'T' };
+	constexpr uint32_t CompletionVersion = 1;
+
+	/// @brief сформировать двоичную таблицу автодополнения по зарегистрированным аргументам
+	std::string buildCompletionTable(const ArgsParser& parser);
+	/// @brief сохранить таблицу автодополнения в файл
+	bool saveCompletionTable(const ArgsParser& parser, const std::string& path);
+
+	/// @brief скрипт автодополнения для bash; программа вызывается как program --complete <предыдущее слово> <текущее слово>
+	std::string bashCompletionScript(const std::string& program);
+	/// @brief скрипт автодополнения для zsh с тем же протоколом
+	std::string zshCompletionScript(const std::string& program);
+
+	/// @brief Таблица автодополнения, отображенная в память
+	/// Отвечает на запросы без создания аргументов и парсера.
+	class CompletionIndex {
+	public:
+		// открытие таблицы и проверка заголовка
+		bool open(const std::string& path);
+		// таблица из памяти, например сформированная buildCompletionTable
+		bool assign(std::string table);
+		// варианты дополнения текущего слова с учетом предыдущего слова
+		std::vector<std::string> complete(std::string_view previous, std::string_view current) const;
+
+	private:
+		// проверка заголовка и ссылок таблицы, content должен жить не меньше индекса
+		bool attach(std::string_view content);
+		std::string_view text(const CompletionString& ref) const { return strings_.substr(ref.offset, ref.size); }
+		// аргумент по длинному или короткому имени в виде --name или -n, nullptr если не найден
+		const CompletionEntry* findOption(std::string_view word) const;
+		// значения аргумента, начинающиеся с prefix
+		void completeValues(const CompletionEntry& entry, std::string_view prefix, std::string_view prepend, std::vector<std::string>& result) const;
+
+		MappedFile file_;
+		std::string table_;
+		const CompletionEntry* entries_ = nullptr;
+		const CompletionString* choices_ = nullptr;
+		uint32_t entryCount_ = 0;
+		uint32_t choiceCount_ = 0;
+		std::string_view strings_;
+	};
+
+	/// @brief путь таблицы по умолчанию: настоящий путь программы (/proc/self/exe) + ".complete";
+	/// скрипты вызывают программу по имени из PATH, поэтому argv[0] используется, только если путь не определить
+	std::string completionIndexPath(const char* argv0);
+
+	/// @brief быстрый путь автодополнения: если argv[1] == "--complete", отвечает по таблице indexPath
+	/// (по умолчанию completionIndexPath(argv[0])), выводит варианты по одному в строке и возвращает true.
+	/// Вызывается в начале main, до создания аргументов. Если таблицы нет или она старше программы,
+	/// возвращает false: после регистрации аргументов нужно вызвать completeFromParser.
+	bool completeFromIndex(int argc, const char** argv, const std::string& indexPath = {});
+	/// @brief медленный путь автодополнения по зарегистрированным аргументам, тот же протокол, что у completeFromIndex
+	bool completeFromParser(const ArgsParser& parser, int argc, const char** argv);
+} // namespace args_parse
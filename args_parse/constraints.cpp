@@ -0,0 +1,115 @@
+﻿#include "constraints.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace args_parse {
+	/// @brief построение таблицы без коллизий методом hash and displace:
+	/// значения раскладываются по корзинам, и для каждой корзины, начиная с самых больших,
+	/// подбирается свое зерно, при котором ее значения попадают в свободные ячейки таблицы
+	ChoiceSet::ChoiceSet(std::vector<std::string> choices) {
+		// повторяющиеся значения отбрасываются, иначе для них не найдется зерна без коллизий
+		std::unordered_set<std::string_view> unique;
+		choices_.reserve(choices.size());
+		for (const auto& choice : choices) {
+			if (unique.insert(choice).second)
+				choices_.push_back(choice);
+		}
+		if (choices_.empty())
+			return;
+
+		size_t tableSize = 1;
+		while (tableSize < choices_.size() * 2)
+			tableSize <<= 1;
+		mask_ = tableSize - 1;
+		bucketMask_ = (tableSize >> 1) - 1;
+
+		std::vector<std::vector<int>> buckets(bucketMask_ + 1);
+		for (size_t i = 0; i < choices_.size(); ++i)
+			buckets[hash(choices_[i], 0) & bucketMask_].push_back(static_cast<int>(i));
+		std::vector<size_t> order(buckets.size());
+		for (size_t i = 0; i < order.size(); ++i)
+			order[i] = i;
+		std::stable_sort(order.begin(), order.end(),
+			[&](size_t left, size_t right) { return buckets[left].size() > buckets[right].size(); });
+
+		slots_.assign(tableSize, -1);
+		seeds_.assign(buckets.size(), 0);
+		std::vector<size_t> placed;
+		for (size_t bucket : order) {
+			if (buckets[bucket].empty())
+				break;
+			// таблица заполнена не более чем наполовину, поэтому подходящее зерно находится быстро
+			for (uint32_t seed = 1;; ++seed) {
+				placed.clear();
+				for (int index : buckets[bucket]) {
+					const size_t slot = hash(choices_[index], seed) & mask_;
+					if (slots_[slot] >= 0)
+						break;
+					slots_[slot] = index;
+					placed.push_back(slot);
+				}
+				if (placed.size() == buckets[bucket].size()) {
+					seeds_[bucket] = seed;
+					break;
+				}
+				for (size_t slot : placed)
+					slots_[slot] = -1;
+			}
+		}
+	}
+
+	/// @brief найти значение: два хеширования и одно сравнение строк
+	int ChoiceSet::find(std::string_view value) const {
+		if (choices_.empty())
+			return -1;
+		const uint32_t seed = seeds_[hash(value, 0) & bucketMask_];
+		if (seed == 0)
+			return -1;
+		const int index = slots_[hash(value, seed) & mask_];
+		if (index < 0 || choices_[index] != value)
+			return -1;
+		return index;
+	}
+
+	/// @brief FNV-1a, зерно подмешивается в начальное значение, результат дополнительно перемешивается
+	uint64_t ChoiceSet::hash(std::string_view value, uint64_t seed) {
+		uint64_t result = 14695981039346656037ull ^ (seed * 0x9E3779B97F4A7C15ull);
+		for (unsigned char c : value) {
+			result ^= c;
+			result *= 1099511628211ull;
+		}
+		result ^= result >> 29;
+		result *= 0xBF58476D1CE4E5B9ull;
+		result ^= result >> 32;
+		return result;
+	}
+
+	/// @brief сопоставление с шаблоном без рекурсии, с возвратом к последней звездочке
+	bool MatchPattern(std::string_view pattern, std::string_view text) {
+		size_t p = 0;
+		size_t t = 0;
+		size_t starPos = std::string_view::npos;
+		size_t starText = 0;
+		while (t < text.size()) {
+			if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == text[t])) {
+				++p;
+				++t;
+			}
+			else if (p < pattern.size() && pattern[p] == '*') {
+				starPos = p++;
+				starText = t;
+			}
+			else if (starPos != std::string_view::npos) {
+				p = starPos + 1;
+				t = ++starText;
+			}
+			else {
+				return false;
+			}
+		}
+		while (p < pattern.size() && pattern[p] == '*')
+			++p;
+		return p == pattern.size();
+	}
+} // namespace args_parse
@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include "diagnostics.hpp"
+
+namespace args_parse {
+	/// @brief Множество допустимых строковых значений (аналог enum)
+	/// Идеальная хеш-таблица строится один раз при регистрации, поэтому поиск значения
+	/// стоит двух хеширований и одного сравнения строк независимо от количества значений.
+	class ChoiceSet {
+	public:
+		ChoiceSet() = default;
+		explicit ChoiceSet(std::vector<std::string> choices);
+
+		// множество не задано
+		bool empty() const { return choices_.empty(); }
+		// допустимые значения в порядке задания
+		const std::vector<std::string>& choices() const { return choices_; }
+		// номер значения в списке или -1, если значение недопустимо
+		int find(std::string_view value) const;
+
+	private:
+		// хеш FNV-1a с перемешиванием зерна
+		static uint64_t hash(std::string_view value, uint64_t seed);
+
+		std::vector<std::string> choices_;
+		// номера значений по ячейкам таблицы, -1 для пустой ячейки
+		std::vector<int> slots_;
+		// зерно второго хеша для каждой корзины, 0 для пустой корзины
+		std::vector<uint32_t> seeds_;
+		uint64_t mask_ = 0;
+		uint64_t bucketMask_ = 0;
+	};
+
+	/// @brief сопоставление с шаблоном: * - любая последовательность символов, ? - любой один символ
+	bool MatchPattern(std::string_view pattern, std::string_view text);
+
+	/// @brief Ограничения на значения аргумента, проверяемые сразу после преобразования значения
+	/// Ограничение, неприменимое к типу значения (диапазон для bool, список для int), - ошибка компиляции,
+	/// а не молча игнорируемая настройка.
+	template<typename T>
+	class ValueConstraints {
+		static constexpr bool numeric = std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+		static constexpr bool textual = std::is_same_v<T, std::string>;
+
+	public:
+		// допустимый диапазон [min, max] для числовых аргументов
+		void setRange(const T& min, const T& max) {
+			static_assert(numeric, "Range constraint requires an int or float argument");
+			min_ = min;
+			max_ = max;
+			hasRange_ = true;
+		}
+		// список допустимых значений для строковых аргументов
+		void setChoices(std::vector<std::string> choices) {
+			static_assert(textual, "Choices constraint requires a string argument");
+			choices_ = ChoiceSet(std::move(choices));
+		}
+		// обязательный префикс строкового значения
+		void setPrefix(const std::string& prefix) {
+			static_assert(textual, "Prefix constraint requires a string argument");
+			prefix_ = prefix;
+		}
+		// шаблон строкового значения, см. MatchPattern
+		void setPattern(const std::string& pattern) {
+			static_assert(textual, "Pattern constraint requires a string argument");
+			pattern_ = pattern;
+		}
+
+		const ChoiceSet& choices() const { return choices_; }
+
+		// проверка числового значения
+		template<typename U = T, std::enable_if_t<std::is_arithmetic_v<U>, int> = 0>
+		ErrorCode check(const U& value) const {
+			if (hasRange_ && (value < min_ || value > max_))
+				return ErrorCode::OutOfRange;
+			return ErrorCode::None;
+		}
+
+		// проверка строкового значения до его копирования в аргумент
+		ErrorCode check(std::string_view value) const {
+			if (!choices_.empty() && choices_.find(value) < 0)
+				return ErrorCode::NotInChoices;
+			if (!prefix_.empty() && value.substr(0, prefix_.size()) != prefix_)
+				return ErrorCode::PatternMismatch;
+			if (!pattern_.empty() && !MatchPattern(pattern_, value))
+				return ErrorCode::PatternMismatch;
+			return ErrorCode::None;
+		}
+
+	private:
+		T min_{};
+		T max_{};
+		bool hasRange_ = false;
+		ChoiceSet choices_;
+		std::string prefix_;
+		std::string pattern_;
+	};
+} // namespace args_parse
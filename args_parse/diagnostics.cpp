@@ -0,0 +1,74 @@
+﻿#include "diagnostics.hpp"
+
+#include <cerrno>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace args_parse {
+	/// @brief сформировать сообщение об ошибке
+	std::string formatDiagnostic(const Diagnostic& diagnostic) {
+		switch (diagnostic.code) {
+		case ErrorCode::None:
+			return "No error";
+		case ErrorCode::UnknownArgument:
+			if (!diagnostic.token.empty())
+				return "Error: Unknown argument '" + diagnostic.argument + "', did you mean " + diagnostic.token + "?";
+			return "Error: Unknown argument '" + diagnostic.argument + "'";
+		case ErrorCode::AmbiguousArgument:
+			return "Error: Ambiguous argument '" + diagnostic.argument + "', could be " + diagnostic.token;
+		case ErrorCode::InvalidValue:
+			return "Error: Invalid value '" + diagnostic.token + "' for argument '" + diagnostic.argument + "'";
+		case ErrorCode::UnsupportedType:
+			return "Error: Unsupported type for argument '" + diagnostic.argument + "': " + diagnostic.token;
+		case ErrorCode::NullArgument:
+			return "Error: Attempted to add a null argument.";
+		case ErrorCode::DuplicateShortName:
+			return "Error: Short name '" + diagnostic.argument + "' already exists.";
+		case ErrorCode::DuplicateLongName:
+			return "Error: Long name '" + diagnostic.argument + "' already exists.";
+		case ErrorCode::ConfigFileUnavailable:
+			return "Error: Cannot read config file '" + diagnostic.token + "'";
+		case ErrorCode::OutOfRange:
+			return "Error: Value '" + diagnostic.token + "' for argument '" + diagnostic.argument + "' is out of range";
+		case ErrorCode::NotInChoices:
+			return "Error: Value '" + diagnostic.token + "' for argument '" + diagnostic.argument + "' is not one of the allowed values";
+		case ErrorCode::PatternMismatch:
+			return "Error: Value '" + diagnostic.token + "' for argument '" + diagnostic.argument + "' does not match the expected pattern";
+		case ErrorCode::MissingRequired:
+			return "Error: Required argument '" + diagnostic.argument + "' is missing";
+		case ErrorCode::MutuallyExclusive:
+			return "Error: Argument '" + diagnostic.argument + "' cannot be used together with '" + diagnostic.token + "'";
+		case ErrorCode::RangeTooLarge:
+			return "Error: Ranges in '" + diagnostic.token + "' for argument '" + diagnostic.argument + "' are too large to expand";
+		}
+		return "Error: Unknown error";
+	}
+
+	/// @brief вывести сообщение об ошибке в stderr
+	void writeDiagnosticToStderr(const Diagnostic& diagnostic) {
+		std::string message = formatDiagnostic(diagnostic);
+		message += '\n';
+		writeAll(2, message);
+	}
+
+	/// @brief записать весь буфер, повторяя write при частичной записи и прерывании сигналом
+	bool writeAll(int fd, std::string_view text) {
+		while (!text.empty()) {
+#ifdef _WIN32
+			const int written = _write(fd, text.data(), static_cast<unsigned int>(text.size()));
+#else
+			const auto written = ::write(fd, text.data(), text.size());
+#endif
+			if (written < 0 && errno == EINTR)
+				continue;
+			if (written <= 0)
+				return false;
+			text.remove_prefix(static_cast<size_t>(written));
+		}
+		return true;
+	}
+} // namespace args_parse
@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+#include <functional>
+
+namespace args_parse {
+	/// @brief Коды ошибок разбора и регистрации аргументов
+	enum class ErrorCode {
+		// ошибки нет
+		None,
+		// аргумент с таким именем не зарегистрирован
+		UnknownArgument,
+		// сокращенное имя подходит к нескольким аргументам
+		AmbiguousArgument,
+		// значение не удалось преобразовать к типу аргумента
+		InvalidValue,
+		// тип аргумента не поддерживается
+		UnsupportedType,
+		// попытка добавить нулевой аргумент
+		NullArgument,
+		// короткое имя уже занято другим аргументом
+		DuplicateShortName,
+		// длинное имя уже занято другим аргументом
+		DuplicateLongName,
+		// конфигурационный файл не удалось прочитать
+		ConfigFileUnavailable,
+		// значение вне допустимого диапазона
+		OutOfRange,
+		// значение не входит в список допустимых
+		NotInChoices,
+		// значение не соответствует префиксу или шаблону
+		PatternMismatch,
+		// обязательный аргумент не задан
+		MissingRequired,
+		// заданы взаимоисключающие аргументы
+		MutuallyExclusive,
+		// диапазон слишком велик, чтобы развернуть его в столбец значений
+		RangeTooLarge,
+	};
+
+	/// @brief Описание одной ошибки: код, аргумент и значение, вызвавшее ошибку
+	struct Diagnostic {
+		ErrorCode code = ErrorCode::None;
+		// имя аргумента в том виде, в котором оно пишется в командной строке (-a или --age)
+		std::string argument;
+		// значение, которое не удалось обработать, либо подходящие имена для неизвестного аргумента
+		std::string token;
+	};
+
+	/// @brief Приемник диагностик, вызывается для каждой новой ошибки
+	using DiagnosticSink = std::function<void(const Diagnostic&)>;
+
+	/// @brief текстовое сообщение для диагностики, без перевода строки в конце
+	std::string formatDiagnostic(const Diagnostic& diagnostic);
+
+	/// @brief приемник по умолчанию: пишет сообщение в stderr одним вызовом write
+	void writeDiagnosticToStderr(const Diagnostic& diagnostic);
+
+	/// @brief запись буфера в файловый дескриптор целиком
+	bool writeAll(int fd, std::string_view text);
+} // namespace args_parse
@@ -0,0 +1,64 @@
+﻿#include "mapped_file.hpp"
+
+#include <cstdio>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace args_parse {
+	MappedFile::~MappedFile() {
+		close();
+	}
+
+	/// @brief отобразить файл в память, при неудаче прочитать его в буфер
+	bool MappedFile::open(const std::string& path) {
+		close();
+#ifndef _WIN32
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat info;
+		if (fstat(fd, &info) == 0 && info.st_size > 0) {
+			void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (address != MAP_FAILED) {
+				data_ = static_cast<const char*>(address);
+				size_ = static_cast<size_t>(info.st_size);
+				mapped_ = true;
+			}
+		}
+		::close(fd);
+#endif
+		if (!mapped_) {
+			// пустой файл или отображение недоступно: читаем файл в буфер
+			std::FILE* file = std::fopen(path.c_str(), "rb");
+			if (!file)
+				return false;
+			char chunk[4096];
+			size_t read;
+			while ((read = std::fread(chunk, 1, sizeof(chunk), file)) > 0)
+				buffer_.append(chunk, read);
+			std::fclose(file);
+			data_ = buffer_.data();
+			size_ = buffer_.size();
+		}
+		open_ = true;
+		return true;
+	}
+
+	/// @brief освободить отображение файла
+	void MappedFile::close() {
+#ifndef _WIN32
+		if (mapped_ && data_)
+			munmap(const_cast<char*>(data_), size_);
+#endif
+		mapped_ = false;
+		open_ = false;
+		data_ = nullptr;
+		size_ = 0;
+		buffer_.clear();
+	}
+} // namespace args_parse
@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace args_parse {
+	/// @brief Файл, отображенный в память только для чтения
+	/// Если отображение недоступно (Windows, пустой файл, ошибка mmap), файл читается в буфер.
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		// открытие файла; ранее открытый файл закрывается
+		bool open(const std::string& path);
+		// освобождение отображения или буфера
+		void close();
+
+		// содержимое файла
+		std::string_view content() const { return std::string_view(data_, size_); }
+		bool isOpen() const { return open_; }
+
+	private:
+		const char* data_ = nullptr;
+		size_t size_ = 0;
+		bool mapped_ = false;
+		bool open_ = false;
+		std::string buffer_;
+	};
+} // namespace args_parse
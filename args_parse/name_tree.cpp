@@ -0,0 +1,169 @@
+﻿#include "name_tree.hpp"
+
+#include <algorithm>
+
+namespace args_parse {
+	/// @brief построить дерево по набору имен
+	void NameTree::build(const std::vector<std::string_view>& names, const std::vector<int>& ids) {
+		std::vector<std::pair<std::string_view, int>> sorted;
+		sorted.reserve(names.size());
+		for (size_t i = 0; i < names.size(); ++i)
+			sorted.emplace_back(names[i], ids[i]);
+		std::sort(sorted.begin(), sorted.end());
+
+		nodes_.assign(1, Node{});
+		labels_.clear();
+		if (!sorted.empty())
+			buildNode(0, sorted, 0, sorted.size(), 0);
+	}
+
+	/// @brief построить поддерево: имя длины depth заканчивается в узле, остальные группируются по следующему символу
+	void NameTree::buildNode(uint32_t node, const std::vector<std::pair<std::string_view, int>>& names, size_t first, size_t last, size_t depth) {
+		nodes_[node].uniqueId = (last - first == 1) ? names[first].second : Ambiguous;
+		if (names[first].first.size() == depth) {
+			nodes_[node].id = names[first].second;
+			++first;
+		}
+
+		// границы групп с одинаковым символом в позиции depth
+		std::vector<size_t> bounds;
+		for (size_t i = first; i < last; ++i) {
+			if (i == first || names[i].first[depth] != names[i - 1].first[depth])
+				bounds.push_back(i);
+		}
+		bounds.push_back(last);
+
+		// дочерние узлы создаются подряд, затем заполняются рекурсивно
+		const uint32_t firstChild = static_cast<uint32_t>(nodes_.size());
+		const uint32_t childCount = static_cast<uint32_t>(bounds.size() - 1);
+		nodes_[node].firstChild = firstChild;
+		nodes_[node].childCount = childCount;
+		nodes_.resize(nodes_.size() + childCount);
+
+		for (uint32_t c = 0; c < childCount; ++c) {
+			const size_t groupFirst = bounds[c];
+			const size_t groupLast = bounds[c + 1];
+			// общий префикс группы: имена отсортированы, достаточно сравнить первое и последнее
+			std::string_view low = names[groupFirst].first;
+			std::string_view high = names[groupLast - 1].first;
+			size_t end = depth + 1;
+			while (end < low.size() && end < high.size() && low[end] == high[end])
+				++end;
+
+			Node& child = nodes_[firstChild + c];
+			child.labelOffset = static_cast<uint32_t>(labels_.size());
+			child.labelSize = static_cast<uint32_t>(end - depth);
+			labels_.append(low.substr(depth, end - depth));
+			buildNode(firstChild + c, names, groupFirst, groupLast, end);
+		}
+	}
+
+	/// @brief спуститься по префиксу; exact - префикс закончился ровно на границе узла
+	bool NameTree::descend(std::string_view prefix, uint32_t& node, bool& exact) const {
+		node = 0;
+		size_t pos = 0;
+		exact = true;
+		while (pos < prefix.size()) {
+			const Node& current = nodes_[node];
+			// дочерние узлы упорядочены по первому символу метки
+			const Node* children = nodes_.data() + current.firstChild;
+			const Node* childrenEnd = children + current.childCount;
+			const char c = prefix[pos];
+			const Node* child = std::lower_bound(children, childrenEnd, c,
+				[&](const Node& n, char value) { return labels_[n.labelOffset] < value; });
+			if (child == childrenEnd || labels_[child->labelOffset] != c)
+				return false;
+
+			std::string_view label(labels_.data() + child->labelOffset, child->labelSize);
+			const size_t common = std::min(label.size(), prefix.size() - pos);
+			if (prefix.compare(pos, common, label, 0, common) != 0)
+				return false;
+			node = static_cast<uint32_t>(child - nodes_.data());
+			pos += common;
+			exact = common == label.size();
+		}
+		return true;
+	}
+
+	/// @brief найти имя по точному совпадению или однозначному префиксу
+	int NameTree::resolvePrefix(std::string_view prefix) const {
+		if (empty())
+			return NotFound;
+		uint32_t node;
+		bool exact;
+		if (!descend(prefix, node, exact))
+			return NotFound;
+		// точное совпадение важнее более длинных имен с тем же префиксом
+		if (exact && nodes_[node].id != NotFound)
+			return nodes_[node].id;
+		return nodes_[node].uniqueId;
+	}
+
+	/// @brief собрать имена, начинающиеся с префикса
+	std::vector<int> NameTree::completions(std::string_view prefix, size_t limit) const {
+		std::vector<int> ids;
+		uint32_t node;
+		bool exact;
+		if (!empty() && descend(prefix, node, exact))
+			collect(node, ids, limit);
+		return ids;
+	}
+
+	/// @brief обход поддерева в лексикографическом порядке
+	void NameTree::collect(uint32_t node, std::vector<int>& ids, size_t limit) const {
+		if (ids.size() >= limit)
+			return;
+		if (nodes_[node].id != NotFound)
+			ids.push_back(nodes_[node].id);
+		for (uint32_t c = 0; c < nodes_[node].childCount; ++c)
+			collect(nodes_[node].firstChild + c, ids, limit);
+	}
+
+	/// @brief найти похожие имена: строка матрицы Левенштейна считается для каждого символа пути,
+	/// поддерево отбрасывается, как только минимум строки превышает maxDistance
+	std::vector<NameTree::Suggestion> NameTree::suggest(std::string_view name, size_t maxDistance, size_t limit) const {
+		std::vector<Suggestion> result;
+		if (empty())
+			return result;
+		// строки матрицы для каждой глубины лежат в одном буфере
+		const size_t width = name.size() + 1;
+		std::vector<size_t> rows(width);
+		for (size_t i = 0; i < width; ++i)
+			rows[i] = i;
+		suggestNode(0, name, 0, maxDistance, rows, result);
+
+		std::stable_sort(result.begin(), result.end(),
+			[](const Suggestion& left, const Suggestion& right) { return left.distance < right.distance; });
+		if (result.size() > limit)
+			result.resize(limit);
+		return result;
+	}
+
+	/// @brief обработать узел: строки матрицы для символов метки, затем дочерние узлы
+	void NameTree::suggestNode(uint32_t node, std::string_view name, size_t depth, size_t maxDistance,
+		std::vector<size_t>& rows, std::vector<Suggestion>& result) const {
+		const size_t width = name.size() + 1;
+		const Node& current = nodes_[node];
+		for (uint32_t k = 0; k < current.labelSize; ++k) {
+			const char c = labels_[current.labelOffset + k];
+			const size_t previous = (depth + k) * width;
+			const size_t row = previous + width;
+			if (rows.size() < row + width)
+				rows.resize(row + width);
+			rows[row] = rows[previous] + 1;
+			size_t rowMin = rows[row];
+			for (size_t i = 1; i < width; ++i) {
+				const size_t substitution = rows[previous + i - 1] + (name[i - 1] == c ? 0 : 1);
+				rows[row + i] = std::min({ rows[previous + i] + 1, rows[row + i - 1] + 1, substitution });
+				rowMin = std::min(rowMin, rows[row + i]);
+			}
+			if (rowMin > maxDistance)
+				return;
+		}
+		const size_t last = (depth + current.labelSize) * width;
+		if (current.id != NotFound && rows[last + width - 1] <= maxDistance)
+			result.push_back(Suggestion{ current.id, rows[last + width - 1] });
+		for (uint32_t c = 0; c < current.childCount; ++c)
+			suggestNode(current.firstChild + c, name, depth + current.labelSize, maxDistance, rows, result);
+	}
+} // namespace args_parse
@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace args_parse {
+	/// @brief Сжатое префиксное дерево (radix tree) по длинным именам аргументов
+	/// Узлы хранятся в одном массиве, дочерние узлы каждого узла лежат подряд и упорядочены,
+	/// метки ребер хранятся в общем буфере. Дерево строится один раз по всему набору имен.
+	class NameTree {
+	public:
+		// результат поиска по префиксу: имени нет
+		static constexpr int NotFound = -1;
+		// результат поиска по префиксу: префикс подходит к нескольким именам
+		static constexpr int Ambiguous = -2;
+
+		/// @brief Вариант исправления опечатки
+		struct Suggestion {
+			int id;
+			size_t distance;
+		};
+
+		// построение дерева; ids[i] - идентификатор имени names[i]
+		void build(const std::vector<std::string_view>& names, const std::vector<int>& ids);
+		// дерево пустое
+		bool empty() const { return nodes_.size() <= 1; }
+
+		// поиск по точному имени или однозначному префиксу за O(длины префикса);
+		// возвращает идентификатор имени, NotFound или Ambiguous
+		int resolvePrefix(std::string_view prefix) const;
+		// идентификаторы имен, начинающихся с префикса, не более limit штук
+		std::vector<int> completions(std::string_view prefix, size_t limit) const;
+		// имена на расстоянии Левенштейна не больше maxDistance, ближайшие первыми, не более limit штук
+		std::vector<Suggestion> suggest(std::string_view name, size_t maxDistance, size_t limit) const;
+
+	private:
+		/// @brief Узел дерева
+		struct Node {
+			// метка ребра, ведущего в узел: смещение и длина в labels_
+			uint32_t labelOffset = 0;
+			uint32_t labelSize = 0;
+			// дочерние узлы: индекс первого и количество
+			uint32_t firstChild = 0;
+			uint32_t childCount = 0;
+			// идентификатор имени, которое заканчивается в узле, или NotFound
+			int id = NotFound;
+			// идентификатор единственного имени в поддереве, NotFound или Ambiguous
+			int uniqueId = NotFound;
+		};
+
+		// рекурсивное построение поддерева по отсортированному диапазону имен с общим префиксом длины depth
+		void buildNode(uint32_t node, const std::vector<std::pair<std::string_view, int>>& names, size_t first, size_t last, size_t depth);
+		// спуск по префиксу; возвращает узел, в поддереве которого лежат все имена с этим префиксом
+		bool descend(std::string_view prefix, uint32_t& node, bool& exact) const;
+		// сбор идентификаторов поддерева
+		void collect(uint32_t node, std::vector<int>& ids, size_t limit) const;
+		// обход с ограниченным расстоянием Левенштейна
+		void suggestNode(uint32_t node, std::string_view name, size_t depth, size_t maxDistance,
+			std::vector<size_t>& rows, std::vector<Suggestion>& result) const;
+
+		std::vector<Node> nodes_;
+		std::string labels_;
+	};
+} // namespace args_parse
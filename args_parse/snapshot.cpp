@@ -0,0 +1,146 @@
+﻿#include "snapshot.hpp"
+#include "args.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace args_parse {
+	/// @brief дописать в буфер двоичное представление структуры
+	template<typename T>
+	static void appendRaw(std::string& out, const T& value) {
+		out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	/// @brief сформировать снимок: сохраняются только аргументы, получившие значение
+	std::string saveState(const ArgsParser& parser) {
+		SnapshotHeader header{};
+		std::memcpy(header.magic, SnapshotMagic, sizeof(header.magic));
+		header.version = SnapshotVersion;
+
+		std::string body;
+		std::string payload;
+		for (const Arg* arg : parser.args()) {
+			if (!arg->isDefined())
+				continue;
+			payload.clear();
+			arg->save(payload);
+
+			SnapshotEntry entry{};
+			entry.nameSize = static_cast<uint32_t>(arg->longName().size());
+			entry.payloadSize = static_cast<uint32_t>(payload.size());
+			entry.shortName = arg->shortName();
+			entry.valueType = static_cast<uint8_t>(arg->valueType());
+			entry.multi = arg->isMulti() ? 1 : 0;
+			appendRaw(body, entry);
+			body += arg->longName();
+			body += payload;
+			++header.entryCount;
+		}
+
+		std::string snapshot;
+		snapshot.reserve(sizeof(header) + body.size());
+		appendRaw(snapshot, header);
+		snapshot += body;
+		return snapshot;
+	}
+
+	/// @brief сохранить снимок в файл
+	bool saveStateToFile(const ArgsParser& parser, const std::string& path) {
+		const std::string snapshot = saveState(parser);
+		std::FILE* file = std::fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+		const bool written = std::fwrite(snapshot.data(), 1, snapshot.size(), file) == snapshot.size();
+		return std::fclose(file) == 0 && written;
+	}
+
+	/// @brief записать снимок в дескриптор
+	bool saveStateToFd(const ArgsParser& parser, int fd) {
+		return writeAll(fd, saveState(parser));
+	}
+
+	/// @brief загрузить значения из снимка
+	bool loadState(ArgsParser& parser, std::string_view snapshot) {
+		SnapshotHeader header;
+		if (snapshot.size() < sizeof(header))
+			return false;
+		std::memcpy(&header, snapshot.data(), sizeof(header));
+		if (std::memcmp(header.magic, SnapshotMagic, sizeof(header.magic)) != 0 || header.version != SnapshotVersion)
+			return false;
+		snapshot.remove_prefix(sizeof(header));
+
+		// первый проход: проверка записей, сопоставление с аргументами и разбор значений во временные;
+		// entryCount не доверенный, поэтому резерв ограничен числом записей, помещающихся в снимок
+		std::vector<std::function<void()>> commits;
+		commits.reserve(std::min<size_t>(header.entryCount, snapshot.size() / sizeof(SnapshotEntry)));
+		for (uint32_t i = 0; i < header.entryCount; ++i) {
+			SnapshotEntry entry;
+			if (snapshot.size() < sizeof(entry))
+				return false;
+			std::memcpy(&entry, snapshot.data(), sizeof(entry));
+			snapshot.remove_prefix(sizeof(entry));
+			if (snapshot.size() < static_cast<uint64_t>(entry.nameSize) + entry.payloadSize)
+				return false;
+			const std::string_view name = snapshot.substr(0, entry.nameSize);
+			std::string_view payload = snapshot.substr(entry.nameSize, entry.payloadSize);
+			snapshot.remove_prefix(entry.nameSize + entry.payloadSize);
+
+			// поиск по хеш-таблицам имен парсера; запись без длинного имени относится только к аргументу без него
+			Arg* found = name.empty() ? parser.findByShortName(entry.shortName) : parser.findByLongName(name);
+			if (found && name.empty() && !found->longName().empty())
+				found = nullptr;
+			if (!found || static_cast<uint8_t>(found->valueType()) != entry.valueType || found->isMulti() != (entry.multi != 0))
+				return false;
+			// данные записи должны быть прочитаны полностью
+			std::function<void()> commit = found->load(payload);
+			if (!commit || !payload.empty())
+				return false;
+			commits.push_back(std::move(commit));
+		}
+		if (!snapshot.empty())
+			return false;
+
+		// второй проход: перенос значений, когда весь снимок разобран без ошибок
+		for (auto& commit : commits)
+			commit();
+		return true;
+	}
+
+	/// @brief загрузить снимок из файла
+	bool loadStateFromFile(ArgsParser& parser, const std::string& path) {
+		MappedFile file;
+		return file.open(path) && loadState(parser, file.content());
+	}
+
+	/// @brief загрузить снимок из дескриптора, читая до конца потока
+	bool loadStateFromFd(ArgsParser& parser, int fd) {
+		std::string snapshot;
+		char buffer[4096];
+		for (;;) {
+#ifdef _WIN32
+			const int count = _read(fd, buffer, sizeof(buffer));
+#else
+			const auto count = ::read(fd, buffer, sizeof(buffer));
+#endif
+			if (count < 0 && errno == EINTR)
+				continue;
+			if (count < 0)
+				return false;
+			if (count == 0)
+				break;
+			snapshot.append(buffer, static_cast<size_t>(count));
+		}
+		return loadState(parser, snapshot);
+	}
+} // namespace args_parse
@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace args_parse {
+	class ArgsParser;
+
+	/// @brief Двоичный снимок разобранных значений аргументов для передачи дочернему процессу
+	/// Формат (поля в порядке байтов машины, без указателей, поэтому снимок можно отображать в память):
+	///   SnapshotHeader, затем для каждого заданного аргумента SnapshotEntry, имя и данные значения.
+	/// Данные значения записываются методом Arg::save: числа фиксированного размера, строки с длиной впереди,
+	/// UserChrono в микросекундах, для множественных аргументов также границы и позиции диапазонов.
+	struct SnapshotHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t reserved;
+	};
+
+	/// @brief Заголовок записи одного аргумента
+	struct SnapshotEntry {
+		// длина длинного имени; при пустом имени аргумент ищется по короткому
+		uint32_t nameSize;
+		uint32_t payloadSize;
+		char shortName;
+		// ValueType
+		uint8_t valueType;
+		uint8_t multi;
+		uint8_t reserved;
+	};
+
+	// сигнатура и версия формата снимка
+	constexpr char SnapshotMagic[4] = { 'A', 'P', 'S', 'N' };
+	constexpr uint32_t SnapshotVersion = 1;
+
+	/// @brief сформировать снимок значений всех заданных аргументов
+	std::string saveState(const ArgsParser& parser);
+	/// @brief сохранить снимок в файл
+	bool saveStateToFile(const ArgsParser& parser, const std::string& path);
+	/// @brief записать снимок в открытый дескриптор (канал или файл)
+	bool saveStateToFd(const ArgsParser& parser, int fd);
+
+	/// @brief загрузить значения из снимка в аргументы парсера
+	/// Снимок сначала проверяется и разбирается целиком (сигнатура, версия, границы записей, имена и типы
+	/// аргументов, данные значений), и только затем значения переносятся в аргументы: при любой ошибке
+	/// ни один аргумент не меняется. Аргументы, отсутствующие в снимке, не изменяются.
+	bool loadState(ArgsParser& parser, std::string_view snapshot);
+	/// @brief загрузить снимок из файла, отображенного в память
+	bool loadStateFromFile(ArgsParser& parser, const std::string& path);
+	/// @brief загрузить снимок, прочитав дескриптор до конца (например, унаследованный от родителя канал)
+	bool loadStateFromFd(ArgsParser& parser, int fd);
+} // namespace args_parse
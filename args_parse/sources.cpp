@@ -0,0 +1,112 @@
+﻿#include "sources.hpp"
+
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <stdlib.h>
+#else
+extern char** environ;
+#endif
+
+namespace args_parse {
+	/// @brief имя переменной окружения: префикс, подчеркивание и длинное имя в верхнем регистре, '-' заменяется на '_'
+	std::string EnvironmentSource::keyFor(const std::string& longName) const {
+		std::string key;
+		key.reserve(prefix_.size() + 1 + longName.size());
+		key += prefix_;
+		key += '_';
+		for (char c : longName) {
+			if (c == '-')
+				key += '_';
+			else if (c >= 'a' && c <= 'z')
+				key += static_cast<char>(c - 'a' + 'A');
+			else
+				key += c;
+		}
+		return key;
+	}
+
+	/// @brief найти значение переменной окружения для аргумента
+	bool EnvironmentSource::find(const std::string& longName, std::string_view& value) {
+		if (!enabled())
+			return false;
+		if (!indexed_)
+			buildIndex();
+		auto iter = index_.find(keyFor(longName));
+		if (iter == index_.end())
+			return false;
+		value = iter->second;
+		return true;
+	}
+
+	/// @brief один проход по окружению, в индекс попадают только переменные с префиксом
+	void EnvironmentSource::buildIndex() {
+		indexed_ = true;
+#ifdef _WIN32
+		char** env = _environ;
+#else
+		char** env = environ;
+#endif
+		if (!env)
+			return;
+		for (; *env; ++env) {
+			std::string_view entry = *env;
+			if (entry.size() <= prefix_.size() || entry.compare(0, prefix_.size(), prefix_) != 0 || entry[prefix_.size()] != '_')
+				continue;
+			size_t equalPos = entry.find('=');
+			if (equalPos == std::string_view::npos)
+				continue;
+			index_[std::string(entry.substr(0, equalPos))] = std::string(entry.substr(equalPos + 1));
+		}
+	}
+
+	/// @brief отобразить файл в память и проиндексировать
+	bool ConfigFile::load() {
+		if (loaded_)
+			return available_;
+		loaded_ = true;
+		if (!enabled() || !file_.open(path_))
+			return false;
+		available_ = true;
+		buildIndex();
+		return true;
+	}
+
+	/// @brief убрать пробелы и табуляции по краям
+	static std::string_view trim(std::string_view text) {
+		while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+			text.remove_prefix(1);
+		while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r'))
+			text.remove_suffix(1);
+		return text;
+	}
+
+	/// @brief один проход по файлу: каждая строка key = value добавляется в индекс, последнее значение побеждает
+	void ConfigFile::buildIndex() {
+		std::string_view content = file_.content();
+		while (!content.empty()) {
+			size_t lineEnd = content.find('\n');
+			std::string_view line = trim(content.substr(0, lineEnd));
+			content.remove_prefix(lineEnd == std::string_view::npos ? content.size() : lineEnd + 1);
+			if (line.empty() || line.front() == '#' || line.front() == ';')
+				continue;
+			size_t equalPos = line.find('=');
+			if (equalPos == std::string_view::npos)
+				continue;
+			std::string_view key = trim(line.substr(0, equalPos));
+			if (!key.empty())
+				index_[key] = trim(line.substr(equalPos + 1));
+		}
+	}
+
+	/// @brief найти значение по ключу
+	bool ConfigFile::find(std::string_view key, std::string_view& value) {
+		if (!load())
+			return false;
+		auto iter = index_.find(key);
+		if (iter == index_.end())
+			return false;
+		value = iter->second;
+		return true;
+	}
+} // namespace args_parse
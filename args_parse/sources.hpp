@@ -0,0 +1,62 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "mapped_file.hpp"
+
+namespace args_parse {
+	/// @brief Источник значений из переменных окружения вида PREFIX_LONG_NAME
+	/// Окружение просматривается один раз при первом обращении, дальше поиск идет по индексу.
+	class EnvironmentSource {
+	public:
+		EnvironmentSource() = default;
+		explicit EnvironmentSource(const std::string& prefix) : prefix_(prefix) {}
+
+		// префикс переменных, например APP для APP_THREADS
+		const std::string& prefix() const { return prefix_; }
+		// источник задан
+		bool enabled() const { return !prefix_.empty(); }
+		// имя переменной окружения для длинного имени аргумента: threads -> APP_THREADS
+		std::string keyFor(const std::string& longName) const;
+		// поиск значения для длинного имени аргумента
+		bool find(const std::string& longName, std::string_view& value);
+
+	private:
+		// построение индекса по переменным с нужным префиксом
+		void buildIndex();
+
+		std::string prefix_;
+		// значения копируются: setenv может перераспределить строки environ после построения индекса
+		std::unordered_map<std::string, std::string> index_;
+		bool indexed_ = false;
+	};
+
+	/// @brief Конфигурационный файл из строк вида key = value
+	/// Файл отображается в память и индексируется по ключам один раз, при первом обращении.
+	/// Пустые строки и строки, начинающиеся с # или ;, пропускаются.
+	class ConfigFile {
+	public:
+		ConfigFile() = default;
+		explicit ConfigFile(const std::string& path) : path_(path) {}
+
+		// путь к файлу
+		const std::string& path() const { return path_; }
+		// источник задан
+		bool enabled() const { return !path_.empty(); }
+		// отображение файла в память и построение индекса; повторные вызовы ничего не делают
+		bool load();
+		// поиск значения по ключу (длинному имени аргумента); файл загружается при первом обращении
+		bool find(std::string_view key, std::string_view& value);
+
+	private:
+		// построение индекса по содержимому файла
+		void buildIndex();
+
+		std::string path_;
+		MappedFile file_;
+		std::unordered_map<std::string_view, std::string_view> index_;
+		bool loaded_ = false;
+		bool available_ = false;
+	};
+} // namespace args_parse
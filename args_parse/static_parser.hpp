@@ -0,0 +1,227 @@
+﻿#pragma once
+
+#include <array>
+#include <bitset>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "args.hpp"
+
+namespace args_parse {
+	/// @brief Преобразование значения в поле структуры для статического парсера
+	/// Для неподдерживаемого типа поля парсер не компилируется.
+	template<typename T>
+	struct StaticConverter {
+		static_assert(sizeof(T) == 0, "Unsupported option type for StaticParser");
+	};
+
+	template<>
+	struct StaticConverter<int> {
+		static ErrorCode convert(std::string_view value, int& out) {
+			return ParseNumber(value, out) ? ErrorCode::None : ErrorCode::InvalidValue;
+		}
+	};
+
+	template<>
+	struct StaticConverter<float> {
+		static ErrorCode convert(std::string_view value, float& out) {
+			return ParseNumber(value, out) ? ErrorCode::None : ErrorCode::InvalidValue;
+		}
+	};
+
+	template<>
+	struct StaticConverter<bool> {
+		static ErrorCode convert(std::string_view value, bool& out) {
+			if (value == "true" || value == "1")
+				out = true;
+			else if (value == "false" || value == "0")
+				out = false;
+			else
+				return ErrorCode::InvalidValue;
+			return ErrorCode::None;
+		}
+	};
+
+	// string_view ссылается на argv и не требует выделения памяти
+	template<>
+	struct StaticConverter<std::string_view> {
+		static ErrorCode convert(std::string_view value, std::string_view& out) {
+			out = value;
+			return ErrorCode::None;
+		}
+	};
+
+	template<>
+	struct StaticConverter<std::string> {
+		static ErrorCode convert(std::string_view value, std::string& out) {
+			out = value;
+			return ErrorCode::None;
+		}
+	};
+
+	template<>
+	struct StaticConverter<UserChrono> {
+		static ErrorCode convert(std::string_view value, UserChrono& out) {
+			return ParseUserChrono(out, value) ? ErrorCode::None : ErrorCode::InvalidValue;
+		}
+	};
+
+	/// @brief разбор типа указателя на поле: структура и тип поля
+	template<typename M>
+	struct MemberTraits;
+
+	template<typename S, typename T>
+	struct MemberTraits<T S::*> {
+		using Struct = S;
+		using Type = T;
+	};
+
+	/// @brief Описание опции статического парсера: имена и поле структуры, в которое пишется значение
+	template<auto Member>
+	struct StaticOption {
+		using Struct = typename MemberTraits<decltype(Member)>::Struct;
+		using Type = typename MemberTraits<decltype(Member)>::Type;
+
+		char shortName;
+		std::string_view longName;
+
+		// преобразование значения сразу в поле структуры, без виртуальных вызовов
+		static ErrorCode assign(Struct& out, std::string_view value) {
+			return StaticConverter<Type>::convert(value, out.*Member);
+		}
+	};
+
+	/// @brief создание описания опции: option<&Options::threads>('t', "threads")
+	template<auto Member>
+	constexpr StaticOption<Member> option(char shortName, std::string_view longName) {
+		return StaticOption<Member>{ shortName, longName };
+	}
+
+	/// @brief создание описания опции только с длинным именем
+	template<auto Member>
+	constexpr StaticOption<Member> option(std::string_view longName) {
+		return StaticOption<Member>{ '\0', longName };
+	}
+
+	/// @brief Результат статического разбора
+	template<size_t N>
+	struct StaticParseResult {
+		// первая ошибка разбора
+		ErrorCode code = ErrorCode::None;
+		// номер элемента argv, на котором произошла ошибка
+		int index = 0;
+		// опции, получившие значение, в порядке объявления
+		std::bitset<N> present;
+
+		explicit operator bool() const { return code == ErrorCode::None; }
+	};
+
+	/// @brief Статический парсер командной строки в обычную структуру
+	/// Опции задаются списком на этапе компиляции, значения пишутся прямо в поля структуры
+	/// через таблицу функций преобразования. Парсер не использует виртуальные вызовы,
+	/// объекты Arg и динамическую память и может работать рядом с ArgsParser.
+	template<typename Struct, typename... Options>
+	class StaticParser {
+	public:
+		static constexpr size_t Size = sizeof...(Options);
+		static_assert(Size > 0, "StaticParser requires at least one option");
+		static_assert((std::is_same_v<Struct, typename Options::Struct> && ...), "All options must belong to the same struct");
+
+		using Converter = ErrorCode(*)(Struct&, std::string_view);
+		using Result = StaticParseResult<Size>;
+
+		constexpr explicit StaticParser(Options... options)
+			: shortNames_{ options.shortName... }, longNames_{ options.longName... } {}
+
+		// разбор командной строки; разбор останавливается на первой ошибке
+		Result parse(int argc, const char** argv, Struct& out) const {
+			Result result;
+			for (int i = 1; i < argc; ++i) {
+				std::string_view arg = argv[i];
+				if (arg.size() < 2 || arg[0] != '-')
+					continue;
+
+				size_t option = Size;
+				std::string_view value;
+				bool inlineValue = false;
+				if (arg[1] == '-') {
+					// --name или --name=value
+					std::string_view name = arg.substr(2);
+					const size_t equalPos = name.find('=');
+					if (equalPos != std::string_view::npos) {
+						value = name.substr(equalPos + 1);
+						name = name.substr(0, equalPos);
+						inlineValue = true;
+					}
+					option = findLong(name);
+				}
+				else {
+					// -n, -n=value или -nvalue
+					option = findShort(arg[1]);
+					if (arg.size() > 2) {
+						value = arg.substr(arg[2] == '=' ? 3 : 2);
+						inlineValue = true;
+					}
+				}
+				if (option == Size)
+					return fail(result, ErrorCode::UnknownArgument, i);
+
+				if (inlineValue) {
+					if (ErrorCode code = converters_[option](out, value); code != ErrorCode::None)
+						return fail(result, code, i);
+				}
+				else {
+					// значения идут следующими элементами argv, как в ArgsParser
+					const int first = i;
+					while (i + 1 < argc && argv[i + 1][0] != '-' && argv[i + 1][0] != '\0') {
+						++i;
+						if (ErrorCode code = converters_[option](out, argv[i]); code != ErrorCode::None)
+							return fail(result, code, i);
+					}
+					if (i == first)
+						return fail(result, ErrorCode::InvalidValue, i);
+				}
+				result.present.set(option);
+			}
+			return result;
+		}
+
+		// короткое и длинное имя опции по номеру в порядке объявления
+		char shortName(size_t option) const { return shortNames_[option]; }
+		std::string_view longName(size_t option) const { return longNames_[option]; }
+
+	private:
+		static Result fail(Result& result, ErrorCode code, int index) {
+			result.code = code;
+			result.index = index;
+			return result;
+		}
+
+		size_t findLong(std::string_view name) const {
+			for (size_t i = 0; i < Size; ++i) {
+				if (longNames_[i] == name && !name.empty())
+					return i;
+			}
+			return Size;
+		}
+
+		size_t findShort(char name) const {
+			for (size_t i = 0; i < Size; ++i) {
+				if (shortNames_[i] == name && name != '\0')
+					return i;
+			}
+			return Size;
+		}
+
+		std::array<char, Size> shortNames_;
+		std::array<std::string_view, Size> longNames_;
+		// таблица преобразований: i-я функция пишет значение в поле i-й опции
+		static constexpr std::array<Converter, Size> converters_{ &Options::assign... };
+	};
+
+	/// @brief создание статического парсера: makeStaticParser(option<&Options::threads>('t', "threads"), ...)
+	template<typename First, typename... Rest>
+	constexpr StaticParser<typename First::Struct, First, Rest...> makeStaticParser(First first, Rest... rest) {
+		return StaticParser<typename First::Struct, First, Rest...>(first, rest...);
+	}
+} // namespace args_parse
@@ -0,0 +1,182 @@
+﻿#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace args_parse {
+	std::atomic<bool> Trace::enabled_{ false };
+
+	namespace {
+		/// @brief Ячейка буфера под seqlock: для события с номером index писатель ставит 2 * index + 1
+		/// перед записью и 2 * index + 2 после нее, поэтому читатель узнает и недописанное, и перезаписанное событие.
+		struct Slot {
+			std::atomic<uint64_t> sequence{ 0 };
+			TraceEvent event;
+		};
+
+		/// @brief Кольцевой буфер событий одного потока
+		/// Пишет только поток-владелец; счетчик публикуется с release, поэтому читатель видит готовые события.
+		struct ThreadBuffer {
+			std::unique_ptr<Slot[]> slots{ new Slot[Trace::BufferSize] };
+			std::atomic<uint64_t> written{ 0 };
+			uint32_t threadId = 0;
+		};
+
+		/// @brief Буферы всех потоков; живут до конца программы, чтобы события завершившихся потоков сохранялись
+		struct Registry {
+			std::mutex mutex;
+			std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+		};
+
+		Registry& registry() {
+			static Registry instance;
+			return instance;
+		}
+
+		ThreadBuffer& localBuffer() {
+			thread_local ThreadBuffer* buffer = nullptr;
+			if (!buffer) {
+				Registry& shared = registry();
+				std::lock_guard<std::mutex> lock(shared.mutex);
+				shared.buffers.push_back(std::make_unique<ThreadBuffer>());
+				buffer = shared.buffers.back().get();
+				buffer->threadId = static_cast<uint32_t>(shared.buffers.size());
+			}
+			return *buffer;
+		}
+
+		const auto startTime = std::chrono::steady_clock::now();
+
+		/// @brief экранирование строки для JSON
+		void appendEscaped(std::string& out, const char* text) {
+			for (; *text; ++text) {
+				const unsigned char c = static_cast<unsigned char>(*text);
+				if (c == '"' || c == '\\') {
+					out += '\\';
+					out += static_cast<char>(c);
+				}
+				else if (c < 0x20) {
+					char escaped[8];
+					std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+					out += escaped;
+				}
+				else {
+					out += static_cast<char>(c);
+				}
+			}
+		}
+
+		/// @brief наносекунды в микросекундах с дробной частью, как принято в формате Chrome trace
+		void appendMicroseconds(std::string& out, uint64_t nanoseconds) {
+			char number[32];
+			std::snprintf(number, sizeof(number), "%llu.%03u", static_cast<unsigned long long>(nanoseconds / 1000),
+				static_cast<unsigned>(nanoseconds % 1000));
+			out += number;
+		}
+	}
+
+	/// @brief время от запуска программы
+	uint64_t Trace::now() {
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count());
+	}
+
+	/// @brief запись события; при переполнении перезаписывается самое старое событие
+	void Trace::record(const TraceEvent& event) {
+		ThreadBuffer& buffer = localBuffer();
+		const uint64_t index = buffer.written.load(std::memory_order_relaxed);
+		Slot& slot = buffer.slots[index & (BufferSize - 1)];
+		slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.event = event;
+		slot.sequence.store(2 * index + 2, std::memory_order_release);
+		buffer.written.store(index + 1, std::memory_order_release);
+	}
+
+	/// @brief очистка буферов всех потоков
+	void Trace::clear() {
+		Registry& shared = registry();
+		std::lock_guard<std::mutex> lock(shared.mutex);
+		for (auto& buffer : shared.buffers)
+			buffer->written.store(0, std::memory_order_release);
+	}
+
+	/// @brief события в формате Chrome trace JSON, события каждого потока в порядке записи
+	std::string Trace::chromeJson() {
+		std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+		bool first = true;
+		Registry& shared = registry();
+		std::lock_guard<std::mutex> lock(shared.mutex);
+		for (const auto& buffer : shared.buffers) {
+			const uint64_t written = buffer->written.load(std::memory_order_acquire);
+			const uint64_t begin = written > BufferSize ? written - BufferSize : 0;
+			for (uint64_t index = begin; index < written; ++index) {
+				// копия события проверяется по счетчику до и после чтения; событие, которое писатель
+				// успел перезаписать, пропускается
+				const Slot& slot = buffer->slots[index & (BufferSize - 1)];
+				const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+				if (sequence != 2 * index + 2)
+					continue;
+				const TraceEvent event = slot.event;
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+					continue;
+				out += first ? "\n" : ",\n";
+				first = false;
+				out += "{\"name\":\"";
+				appendEscaped(out, event.name);
+				out += "\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+				out += std::to_string(buffer->threadId);
+				out += ",\"ts\":";
+				appendMicroseconds(out, event.start);
+				out += ",\"dur\":";
+				appendMicroseconds(out, event.duration);
+				out += ",\"args\":{";
+				bool firstArg = true;
+				if (event.detail[0]) {
+					out += "\"detail\":\"";
+					appendEscaped(out, event.detail);
+					out += "\"";
+					firstArg = false;
+				}
+				for (const auto& [name, value] : { std::make_pair(event.argName1, event.arg1), std::make_pair(event.argName2, event.arg2) }) {
+					if (!name)
+						continue;
+					out += firstArg ? "\"" : ",\"";
+					appendEscaped(out, name);
+					out += "\":";
+					out += std::to_string(value);
+					firstArg = false;
+				}
+				out += "}}";
+			}
+		}
+		out += "\n]}\n";
+		return out;
+	}
+
+	/// @brief сохранить события в файл
+	bool Trace::writeChromeJson(const std::string& path) {
+		const std::string json = chromeJson();
+		std::FILE* file = std::fopen(path.c_str(), "wb");
+		if (!file)
+			return false;
+		const bool written = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+		return std::fclose(file) == 0 && written;
+	}
+
+	/// @brief строковый параметр интервала; длинная строка обрезается с начала, чтобы сохранить конец пути
+	void TraceSpan::setDetail(std::string_view detail) {
+		if (!event_.name)
+			return;
+		const size_t capacity = sizeof(event_.detail) - 1;
+		if (detail.size() > capacity)
+			detail.remove_prefix(detail.size() - capacity);
+		std::memcpy(event_.detail, detail.data(), detail.size());
+		event_.detail[detail.size()] = '\0';
+	}
+} // namespace args_parse
@@ -0,0 +1,112 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <cstdint>
+
+namespace args_parse {
+	/// @brief Событие трассировки: интервал с необязательной строкой и двумя числовыми параметрами
+	struct TraceEvent {
+		const char* name;
+		// начало и длительность в наносекундах от запуска программы
+		uint64_t start;
+		uint64_t duration;
+		const char* argName1;
+		uint64_t arg1;
+		const char* argName2;
+		uint64_t arg2;
+		// строка без выделения памяти; длинные строки обрезаются
+		char detail[96];
+	};
+
+	/// @brief Трассировка в формате Chrome trace (chrome://tracing, Perfetto)
+	/// Каждый поток пишет события в собственный кольцевой буфер без блокировок; при переполнении
+	/// старые события перезаписываются. Пока трассировка выключена, запись стоит одной проверки флага.
+	/// Ячейки буфера защищены счетчиком последовательности (seqlock), поэтому события можно читать,
+	/// пока потоки продолжают писать: недописанные и перезаписанные во время чтения события пропускаются.
+	class Trace {
+	public:
+		// количество событий в буфере одного потока
+		static constexpr size_t BufferSize = 1 << 16;
+
+		/// @brief включена ли трассировка
+		static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+		/// @brief включить или выключить трассировку
+		static void enable(bool value) { enabled_.store(value, std::memory_order_relaxed); }
+		/// @brief текущее время в наносекундах от запуска программы
+		static uint64_t now();
+
+		/// @brief записать событие в буфер текущего потока
+		static void record(const TraceEvent& event);
+		/// @brief удалить все записанные события
+		static void clear();
+
+		/// @brief события всех потоков в формате Chrome trace JSON
+		/// Обычно вызывается при выходе из программы; события, записываемые в момент чтения, могут не попасть в результат.
+		static std::string chromeJson();
+		/// @brief сохранить события в файл
+		static bool writeChromeJson(const std::string& path);
+
+	private:
+		static std::atomic<bool> enabled_;
+	};
+
+	/// @brief Интервал трассировки от создания до разрушения объекта
+	class TraceSpan {
+	public:
+		// событие заполняется, только если трассировка включена; иначе конструктор записывает один указатель
+		explicit TraceSpan(const char* name) {
+			if (Trace::enabled())
+				begin(name, Trace::now());
+			else
+				event_.name = nullptr;
+		}
+
+		~TraceSpan() {
+			end();
+		}
+
+		TraceSpan(const TraceSpan&) = delete;
+		TraceSpan& operator=(const TraceSpan&) = delete;
+
+		// интервал будет записан
+		bool active() const { return event_.name != nullptr; }
+		// завершить интервал раньше разрушения объекта
+		void end() {
+			if (event_.name) {
+				const uint64_t finish = Trace::now();
+				event_.duration = finish - event_.start;
+				Trace::record(event_);
+				event_.name = nullptr;
+			}
+		}
+		// завершить интервал и сразу начать следующий, например следующий этап обработки
+		void restart(const char* name) {
+			if (event_.name) {
+				const uint64_t finish = Trace::now();
+				event_.duration = finish - event_.start;
+				Trace::record(event_);
+				begin(name, finish);
+			}
+		}
+		// строковый параметр, например путь
+		void setDetail(std::string_view detail);
+		// числовые параметры
+		void setArg1(const char* name, uint64_t value) { event_.argName1 = name; event_.arg1 = value; }
+		void setArg2(const char* name, uint64_t value) { event_.argName2 = name; event_.arg2 = value; }
+
+	private:
+		// начало интервала: заполняются только поля, которые читаются при записи события
+		void begin(const char* name, uint64_t start) {
+			event_.name = name;
+			event_.start = start;
+			event_.argName1 = nullptr;
+			event_.argName2 = nullptr;
+			event_.detail[0] = '\0';
+		}
+
+		// не обнуляется при создании: пока трассировка выключена, значимо только поле name
+		TraceEvent event_;
+	};
+} // namespace args_parse
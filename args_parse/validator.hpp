@@ -4,6 +4,7 @@
 #include <string>
 
 namespace args_parse {
+	/// @brief Проверки аргументов; сами проверки ничего не выводят, ошибки регистрирует вызывающий код
 	class Validator {
 	public:
 		static bool validateNewArgument(const Arg* arg);
@@ -1,8 +1,13 @@
 ﻿#include <args_parse/args.hpp>
+#include <args_parse/completion.hpp>
 #include <iostream>
 #include <chrono>
 
 int main(int argc, const char** argv) {
+	// автодополнение отвечает по готовой таблице, не создавая аргументов
+	if (args_parse::completeFromIndex(argc, argv))
+		return 0;
+
 	args_parse::ArgsParser parser;
 
 	// Define arguments
@@ -16,6 +21,10 @@ int main(int argc, const char** argv) {
 	flo.SetDescription("single float argument shows Input f value [float]");
 	us.SetDescription("user single user argument shows time converted to microseconds [value][measure]");
 
+	args_parse::SingleArg<std::string> completion("completion");
+	completion.setChoices({ "bash", "zsh", "index" });
+	completion.SetDescription("print bash or zsh completion script, or write the completion index next to the binary");
+
 	args_parse::MultiArg<int> multiInt('a', "age");
 	args_parse::MultiArg<std::string> multiString('s', "str");
 	args_parse::MultiArg<bool> multiBool('b', "bool");
@@ -31,14 +40,32 @@ int main(int argc, const char** argv) {
 	parser.add(&output);
 	parser.add(&flo);
 	parser.add(&us);
+	parser.add(&completion);
 
 	parser.add(&multiInt);
 	parser.add(&multiString);
 	parser.add(&multiBool);
 	parser.add(&multiFlo);
 
+	// таблицы автодополнения нет или она устарела: отвечаем по зарегистрированным аргументам
+	if (args_parse::completeFromParser(parser, argc, argv))
+		return 0;
+
 	// Parse arguments
 	parser.parse(argc, argv);
+
+	if (completion.isDefined()) {
+		if (completion.value() == "index") {
+			const std::string path = args_parse::completionIndexPath(argv[0]);
+			if (!args_parse::saveCompletionTable(parser, path)) {
+				std::cerr << "Error: Cannot write completion index '" << path << "'" << std::endl;
+				return 1;
+			}
+			return 0;
+		}
+		std::cout << (completion.value() == "bash" ? args_parse::bashCompletionScript("args_parse_demo") : args_parse::zshCompletionScript("args_parse_demo"));
+		return 0;
+	}
 	parser.printHelp();
 
 	//if output was activated
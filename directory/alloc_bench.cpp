@@ -0,0 +1,198 @@
+﻿#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <queue>
+#include <string>
+#include "path_pool.hpp"
+#include "thread_pool.hpp"
+
+// GCC принимает free в замененном operator delete за несоответствие new/delete
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+// Счетчик выделений памяти через глобальный operator new
+static std::atomic<size_t> allocations{ 0 };
+
+void* operator new(size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* pointer = std::malloc(size ? size : 1))
+		return pointer;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+	std::free(pointer);
+}
+
+/// @brief Пул потоков в прежнем виде: std::function в std::queue
+class LegacyThreadPool {
+public:
+	LegacyThreadPool(size_t numThreads) {
+		for (size_t i = 0; i < numThreads; ++i) {
+			workers.emplace_back([this] {
+				while (true) {
+					std::function<void()> task;
+					{
+						std::unique_lock<std::mutex> lock(queueMutex);
+						condition.wait(lock, [this] { return stopped || !tasks.empty(); });
+						if (stopped && tasks.empty()) return;
+						task = std::move(tasks.front());
+						tasks.pop();
+					}
+					task();
+					task = nullptr;
+					std::unique_lock<std::mutex> lock(queueMutex);
+					if (--pending == 0)
+						idleCondition.notify_all();
+				}
+				});
+		}
+	}
+
+	template<class F>
+	void enqueue(F&& f) {
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			tasks.emplace(std::forward<F>(f));
+			++pending;
+		}
+		condition.notify_one();
+	}
+
+	void waitIdle() {
+		std::unique_lock<std::mutex> lock(queueMutex);
+		idleCondition.wait(lock, [this] { return pending == 0; });
+	}
+
+	~LegacyThreadPool() {
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			stopped = true;
+		}
+		condition.notify_all();
+		for (std::thread& worker : workers)
+			worker.join();
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> tasks;
+	std::mutex queueMutex;
+	std::condition_variable condition;
+	std::condition_variable idleCondition;
+	size_t pending = 0;
+	bool stopped = false;
+};
+
+// Задачи ставятся окнами, как при обходе, где в очереди не весь миллион каталогов сразу;
+// окно меньше общего списка PathPool, поэтому после разогрева буферы путей не выделяются заново
+static constexpr size_t Window = 16384;
+
+// Путь длиннее буфера короткой строки, как у реальных каталогов
+static const std::string SamplePath = "/home/user/projects/args_parse/directory/sample/subdirectory";
+
+/// @brief Задача того же размера, что и Task: путь и ссылка на пул
+template<class Pool>
+struct LegacyTask {
+	std::string path;
+	Pool& pool;
+	std::atomic<size_t>& checksum;
+	void operator()() { checksum.fetch_add(path.size(), std::memory_order_relaxed); }
+};
+
+/// @brief Задача с буфером пути из PathPool
+struct PooledTask {
+	std::string path;
+	ThreadPool& pool;
+	std::atomic<size_t>& checksum;
+
+	PooledTask(std::string path, ThreadPool& pool, std::atomic<size_t>& checksum) : path(std::move(path)), pool(pool), checksum(checksum) {}
+	PooledTask(PooledTask&&) noexcept = default;
+	~PooledTask() { PathPool::release(std::move(path)); }
+	void operator()() { checksum.fetch_add(path.size(), std::memory_order_relaxed); }
+};
+
+/// @brief Результат одного прогона
+struct Measurement {
+	double allocationsPerTask;
+	double nanosecondsPerTask;
+};
+
+// Количество измеряемых серий после разогрева
+static constexpr int Repeats = 3;
+
+/// @brief Прогон: разогрев, затем несколько измеряемых серий; берется лучшая по каждому показателю.
+/// Свободные буферы путей могут остаться в кэшах других потоков, и тогда пул один раз добирает буферы;
+/// выделение на каждую задачу повторится во всех сериях, а такое добирание - нет.
+template<class Run>
+Measurement measure(size_t tasks, Run&& run) {
+	run(tasks);
+	Measurement best{ 0, 0 };
+	for (int repeat = 0; repeat < Repeats; ++repeat) {
+		const size_t before = allocations.load();
+		const auto start = std::chrono::steady_clock::now();
+		run(tasks);
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		const Measurement current{ static_cast<double>(allocations.load() - before) / tasks,
+			std::chrono::duration<double, std::nano>(elapsed).count() / tasks };
+		if (repeat == 0 || current.allocationsPerTask < best.allocationsPerTask)
+			best.allocationsPerTask = current.allocationsPerTask;
+		if (repeat == 0 || current.nanosecondsPerTask < best.nanosecondsPerTask)
+			best.nanosecondsPerTask = current.nanosecondsPerTask;
+	}
+	return best;
+}
+
+int main(int argc, char** argv) {
+	const size_t tasks = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+	const size_t threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4;
+	std::atomic<size_t> checksum{ 0 };
+
+	Measurement legacy;
+	{
+		LegacyThreadPool pool(threads);
+		legacy = measure(tasks, [&](size_t count) {
+			for (size_t i = 0; i < count; ++i) {
+				pool.enqueue(LegacyTask<LegacyThreadPool>{ SamplePath, pool, checksum });
+				if ((i + 1) % Window == 0)
+					pool.waitIdle();
+			}
+			pool.waitIdle();
+			});
+	}
+
+	Measurement pooled;
+	{
+		ThreadPool pool(threads);
+		pooled = measure(tasks, [&](size_t count) {
+			for (size_t i = 0; i < count; ++i) {
+				std::string path = PathPool::acquire();
+				path.assign(SamplePath);
+				pool.enqueue(PooledTask(std::move(path), pool, checksum));
+				if ((i + 1) % Window == 0)
+					pool.waitIdle();
+			}
+			pool.waitIdle();
+			});
+	}
+
+	std::cout << "tasks: " << tasks << ", threads: " << threads << "\n"
+		<< "std::function + std::queue: " << legacy.allocationsPerTask << " allocations/task, " << legacy.nanosecondsPerTask << " ns/task\n"
+		<< "InlineTask + RingQueue + PathPool: " << pooled.allocationsPerTask << " allocations/task, " << pooled.nanosecondsPerTask << " ns/task\n"
+		// контрольная сумма выводится, чтобы работа задач не была выброшена оптимизатором
+		<< "checksum: " << checksum.load() << "\n";
+	// выделение памяти на пути задач пула после разогрева - регрессия
+	if (pooled.allocationsPerTask > 0) {
+		std::cerr << "Error: the pooled path allocated memory\n";
+		return 1;
+	}
+	return 0;
+}
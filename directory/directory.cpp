@@ -0,0 +1,49 @@
+﻿#include "directory.hpp"
+
+#include <iostream>
+#include <cstring>
+
+namespace {
+	// Вывод дерева включен
+	std::atomic<bool> outputEnabled{ true };
+}
+
+/// @brief Функция для вывода дерева каталогов
+void printDirectory(const Directory& directory) {
+	// Вывод подкаталогов
+	for (const auto& subdir : directory.subdirectories) {
+		std::cout << "\t" << subdir.name << " (Thread ID: " << subdir.threadId << ")" << std::endl;
+		printDirectory(subdir);
+	}
+	// Вывод файлов
+	for (const auto& file : directory.files) {
+		std::cout << "\t\t" << file << std::endl;
+	}
+}
+
+/// @brief Счетчики текущего обхода
+WalkStats& walkStats() {
+	static WalkStats stats;
+	return stats;
+}
+
+/// @brief Включение и отключение вывода дерева
+void setDirectoryOutput(bool enabled) {
+	outputEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+/// @brief Учет обработанного каталога и его вывод
+void reportDirectory(const Directory& directory) {
+	WalkStats& stats = walkStats();
+	stats.directories.fetch_add(1, std::memory_order_relaxed);
+	stats.files.fetch_add(directory.files.size(), std::memory_order_relaxed);
+	if (outputEnabled.load(std::memory_order_relaxed))
+		printDirectory(directory);
+}
+
+/// @brief Учет и вывод ошибки чтения каталога
+void reportDirectoryError(const std::string& path, int error) {
+	walkStats().errors.fetch_add(1, std::memory_order_relaxed);
+	// одна строка одной операцией, чтобы сообщения разных потоков не перемешивались
+	std::cerr << ("Error: Cannot read directory '" + path + "': " + std::strerror(error) + "\n");
+}
@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+/// @brief Структура для представления дерева каталогов
+struct Directory {
+	// Имя каталога
+	std::string name;
+	// Имена файлов
+	std::vector<std::string> files;
+	// Подкаталоги
+	std::vector<Directory> subdirectories;
+	// Номер потока, который обрабатывал директорию
+	std::thread::id threadId;
+
+	// Конструктор
+	Directory(const std::string& name) : name(name) {}
+};
+
+/// @brief Функция для вывода дерева каталогов
+void printDirectory(const Directory& directory);
+
+/// @brief Счетчики обхода, общие для всех потоков
+struct WalkStats {
+	// Обработанные каталоги
+	std::atomic<uint64_t> directories{ 0 };
+	// Найденные файлы
+	std::atomic<uint64_t> files{ 0 };
+	// Каталоги, которые не удалось прочитать
+	std::atomic<uint64_t> errors{ 0 };
+};
+
+/// @brief Счетчики текущего обхода
+WalkStats& walkStats();
+/// @brief Включение и отключение вывода дерева, например для замеров
+void setDirectoryOutput(bool enabled);
+/// @brief Учет обработанного каталога и его вывод, если вывод не отключен
+void reportDirectory(const Directory& directory);
+/// @brief Учет каталога, который не удалось открыть или прочитать, и вывод ошибки в stderr
+void reportDirectoryError(const std::string& path, int error);
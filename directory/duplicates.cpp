@@ -0,0 +1,312 @@
+﻿#include "duplicates.hpp"
+#include <args_parse/trace.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <cstring>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+	// Размер блока для частичного хеша (начало и конец файла)
+	constexpr size_t PartialBlockSize = 4096;
+	// Размер буфера для чтения всего файла
+	constexpr size_t FullBufferSize = 1 << 20;
+
+	constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+	constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+	constexpr uint64_t Prime3 = 0x165667B19E3779F9ULL;
+	constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+	constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+	inline uint64_t rotl(uint64_t value, int bits) {
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	inline uint64_t read64(const unsigned char* data) {
+		uint64_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t read32(const unsigned char* data) {
+		uint32_t value;
+		std::memcpy(&value, data, sizeof(value));
+		return value;
+	}
+
+	inline uint64_t round(uint64_t accumulator, uint64_t input) {
+		accumulator += input * Prime2;
+		return rotl(accumulator, 31) * Prime1;
+	}
+
+	inline uint64_t mergeRound(uint64_t hash, uint64_t accumulator) {
+		hash ^= round(0, accumulator);
+		return hash * Prime1 + Prime4;
+	}
+
+	/// @brief некриптографический 64-битный хеш (алгоритм XXH64); seed позволяет продолжить хеш по следующему блоку
+	uint64_t hash64(const void* input, size_t length, uint64_t seed) {
+		const unsigned char* data = static_cast<const unsigned char*>(input);
+		const unsigned char* end = data + length;
+		uint64_t hash;
+		if (length >= 32) {
+			uint64_t v1 = seed + Prime1 + Prime2;
+			uint64_t v2 = seed + Prime2;
+			uint64_t v3 = seed;
+			uint64_t v4 = seed - Prime1;
+			for (const unsigned char* limit = end - 32; data <= limit; data += 32) {
+				v1 = round(v1, read64(data));
+				v2 = round(v2, read64(data + 8));
+				v3 = round(v3, read64(data + 16));
+				v4 = round(v4, read64(data + 24));
+			}
+			hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+			hash = mergeRound(hash, v1);
+			hash = mergeRound(hash, v2);
+			hash = mergeRound(hash, v3);
+			hash = mergeRound(hash, v4);
+		}
+		else {
+			hash = seed + Prime5;
+		}
+		hash += length;
+		for (; data + 8 <= end; data += 8)
+			hash = rotl(hash ^ round(0, read64(data)), 27) * Prime1 + Prime4;
+		if (data + 4 <= end) {
+			hash = rotl(hash ^ (read32(data) * Prime1), 23) * Prime2 + Prime3;
+			data += 4;
+		}
+		for (; data < end; ++data)
+			hash = rotl(hash ^ (*data * Prime5), 11) * Prime1;
+		hash ^= hash >> 33;
+		hash *= Prime2;
+		hash ^= hash >> 29;
+		hash *= Prime3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	/// @brief чтение count байт со смещения offset; false при ошибке или неожиданном конце файла
+	bool readAt(int fd, char* buffer, size_t count, uint64_t offset) {
+		while (count > 0) {
+			const auto result = pread(fd, buffer, count, static_cast<off_t>(offset));
+			if (result <= 0)
+				return false;
+			buffer += result;
+			count -= static_cast<size_t>(result);
+			offset += static_cast<uint64_t>(result);
+		}
+		return true;
+	}
+
+	/// @brief Дескриптор файла, закрываемый автоматически
+	class FileHandle {
+	public:
+		FileHandle(const std::string& path) : fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC)) {}
+		~FileHandle() {
+			if (fd >= 0)
+				::close(fd);
+		}
+		FileHandle(const FileHandle&) = delete;
+		FileHandle& operator=(const FileHandle&) = delete;
+
+		int fd;
+	};
+
+	/// @brief Побайтное сравнение двух файлов одного размера
+	bool sameContent(const std::string& leftPath, const std::string& rightPath, uint64_t size) {
+		thread_local std::vector<char> left(FullBufferSize);
+		thread_local std::vector<char> right(FullBufferSize);
+		FileHandle leftFile(leftPath);
+		FileHandle rightFile(rightPath);
+		if (leftFile.fd < 0 || rightFile.fd < 0)
+			return false;
+		for (uint64_t offset = 0; offset < size;) {
+			const size_t count = static_cast<size_t>(std::min<uint64_t>(left.size(), size - offset));
+			if (!readAt(leftFile.fd, left.data(), count, offset) || !readAt(rightFile.fd, right.data(), count, offset)
+				|| std::memcmp(left.data(), right.data(), count) != 0)
+				return false;
+			offset += count;
+		}
+		return true;
+	}
+}
+
+/// @brief Добавить файл: размер определяется в пуле хеширования, а не в потоке обхода
+void DuplicateFinder::add(const std::string& path) {
+	pool.enqueue([this, path = path] {
+		struct stat status;
+		// пустые файлы не считаются дубликатами; lstat, чтобы ссылка на файл не выглядела его копией
+		if (::lstat(path.c_str(), &status) != 0 || !S_ISREG(status.st_mode) || status.st_size == 0)
+			return;
+		const uint64_t size = static_cast<uint64_t>(status.st_size);
+		const FileIdentity identity{ static_cast<uint64_t>(status.st_dev), static_cast<uint64_t>(status.st_ino) };
+		std::vector<size_t> toHash;
+		{
+			std::unique_lock<std::mutex> lock(groupsMutex);
+			// жесткая ссылка на уже добавленный inode: кандидат остается один, в отчет идет наименьший путь
+			auto [known, inserted] = identities.try_emplace(identity, size, groups[size].size());
+			if (!inserted) {
+				auto& candidate = groups[known->second.first][known->second.second];
+				if (path < candidate.path)
+					candidate.path = path;
+				return;
+			}
+			auto& group = groups[size];
+			group.push_back({ path });
+			// второй файл того же размера делает кандидатами оба файла
+			if (group.size() == 2)
+				toHash.push_back(0);
+			if (group.size() >= 2)
+				toHash.push_back(group.size() - 1);
+		}
+		for (size_t index : toHash)
+			pool.enqueue([this, size, index] { hashPartial(size, index); });
+		});
+}
+
+/// @brief Частичный хеш: первый и последний блок файла
+void DuplicateFinder::hashPartial(uint64_t size, size_t index) {
+	std::string path;
+	{
+		std::unique_lock<std::mutex> lock(groupsMutex);
+		path = groups[size][index].path;
+	}
+	args_parse::TraceSpan span("DuplicateFinder::hashPartial");
+	span.setDetail(path);
+	span.setArg1("size", size);
+	char buffer[2 * PartialBlockSize];
+	FileHandle file(path);
+	bool ok = file.fd >= 0;
+	uint64_t hash = 0;
+	if (ok && size <= sizeof(buffer)) {
+		ok = readAt(file.fd, buffer, static_cast<size_t>(size), 0);
+		hash = hash64(buffer, static_cast<size_t>(size), 0);
+	}
+	else if (ok) {
+		ok = readAt(file.fd, buffer, PartialBlockSize, 0) && readAt(file.fd, buffer + PartialBlockSize, PartialBlockSize, size - PartialBlockSize);
+		hash = hash64(buffer, sizeof(buffer), 0);
+	}
+	std::unique_lock<std::mutex> lock(groupsMutex);
+	auto& candidate = groups[size][index];
+	candidate.partialHash = hash;
+	candidate.failed = !ok;
+}
+
+/// @brief Полный хеш: файл читается большими блоками, хеш каждого блока продолжает предыдущий
+void DuplicateFinder::hashFull(uint64_t size, size_t index) {
+	std::string path;
+	{
+		std::unique_lock<std::mutex> lock(groupsMutex);
+		path = groups[size][index].path;
+	}
+	args_parse::TraceSpan span("DuplicateFinder::hashFull");
+	span.setDetail(path);
+	span.setArg1("size", size);
+	thread_local std::vector<char> buffer(FullBufferSize);
+	FileHandle file(path);
+	bool ok = file.fd >= 0;
+	uint64_t hash = 0;
+#ifdef POSIX_FADV_SEQUENTIAL
+	if (ok)
+		posix_fadvise(file.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+	for (uint64_t offset = 0; ok && offset < size;) {
+		const size_t count = static_cast<size_t>(std::min<uint64_t>(buffer.size(), size - offset));
+		ok = readAt(file.fd, buffer.data(), count, offset);
+		hash = hash64(buffer.data(), count, hash);
+		offset += count;
+	}
+	std::unique_lock<std::mutex> lock(groupsMutex);
+	auto& candidate = groups[size][index];
+	candidate.fullHash = hash;
+	candidate.failed = !ok;
+}
+
+/// @brief Разбиение: первый путь сравнивается с остальными, совпавшие образуют набор, остальные проверяются заново
+std::vector<DuplicateSet> splitByContent(uint64_t size, std::vector<std::string> paths) {
+	std::sort(paths.begin(), paths.end());
+	std::vector<DuplicateSet> sets;
+	while (paths.size() >= 2) {
+		std::vector<std::string> same{ paths.front() };
+		std::vector<std::string> rest;
+		for (size_t i = 1; i < paths.size(); ++i)
+			(sameContent(paths.front(), paths[i], size) ? same : rest).push_back(std::move(paths[i]));
+		if (same.size() >= 2)
+			sets.push_back({ size, std::move(same) });
+		paths = std::move(rest);
+	}
+	return sets;
+}
+
+/// @brief Подтверждение набора с одинаковым хешем побайтным сравнением
+void DuplicateFinder::confirm(uint64_t size, std::vector<std::string> paths) {
+	args_parse::TraceSpan span("DuplicateFinder::confirm");
+	span.setArg1("size", size);
+	std::vector<DuplicateSet> sets = splitByContent(size, std::move(paths));
+	if (sets.empty())
+		return;
+	std::unique_lock<std::mutex> lock(groupsMutex);
+	for (auto& set : sets)
+		confirmed.push_back(std::move(set));
+}
+
+/// @brief Завершение: полный хеш считается только для файлов с совпавшим частичным хешем
+std::vector<DuplicateSet> DuplicateFinder::finish() {
+	pool.waitIdle();
+
+	// группы по частичному хешу; файлы не длиннее двух блоков уже прочитаны целиком
+	std::vector<std::pair<uint64_t, std::vector<size_t>>> partialMatches;
+	for (auto& [size, group] : groups) {
+		if (group.size() < 2)
+			continue;
+		std::unordered_map<uint64_t, std::vector<size_t>> byPartial;
+		for (size_t i = 0; i < group.size(); ++i) {
+			if (!group[i].failed)
+				byPartial[group[i].partialHash].push_back(i);
+		}
+		for (auto& [hash, indices] : byPartial) {
+			if (indices.size() < 2)
+				continue;
+			if (size > 2 * PartialBlockSize) {
+				for (size_t index : indices)
+					pool.enqueue([this, size = size, index] { hashFull(size, index); });
+			}
+			partialMatches.emplace_back(size, std::move(indices));
+		}
+	}
+	pool.waitIdle();
+
+	// совпадение хешей не доказывает равенство, поэтому наборы подтверждаются побайтным сравнением
+	for (auto& [size, indices] : partialMatches) {
+		const auto& group = groups[size];
+		std::map<uint64_t, std::vector<std::string>> byFull;
+		for (size_t index : indices) {
+			if (!group[index].failed)
+				byFull[group[index].fullHash].push_back(group[index].path);
+		}
+		for (auto& [hash, paths] : byFull) {
+			if (paths.size() >= 2)
+				pool.enqueue([this, size = size, paths = std::move(paths)]() mutable { confirm(size, std::move(paths)); });
+		}
+	}
+	pool.waitIdle();
+
+	std::vector<DuplicateSet> duplicates = std::move(confirmed);
+	confirmed.clear();
+	std::sort(duplicates.begin(), duplicates.end(),
+		[](const DuplicateSet& left, const DuplicateSet& right) { return left.size != right.size ? left.size > right.size : left.paths < right.paths; });
+	return duplicates;
+}
+
+/// @brief Вывод наборов одинаковых файлов
+void printDuplicates(const std::vector<DuplicateSet>& duplicates) {
+	for (const auto& set : duplicates) {
+		std::cout << "Duplicates (" << set.size << " bytes):" << std::endl;
+		for (const auto& path : set.paths)
+			std::cout << "\t\t" << path << std::endl;
+	}
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include "thread_pool.hpp"
+#include "visited_set.hpp"
+
+/// @brief Набор одинаковых файлов
+struct DuplicateSet {
+	// Размер каждого файла
+	uint64_t size;
+	// Пути к файлам
+	std::vector<std::string> paths;
+};
+
+/// @brief Поиск одинаковых файлов среди найденных при обходе
+/// Файлы группируются по размеру, затем кандидаты сравниваются по хешу первого и последнего блока
+/// и только при совпадении по хешу всего содержимого; наборы с совпавшим хешем подтверждаются побайтным
+/// сравнением. Жесткие ссылки на один inode считаются одним файлом, символические ссылки не учитываются.
+/// Все чтения и stat выполняются собственным пулом потоков, поэтому медленное чтение файлов не задерживает обход каталогов.
+class DuplicateFinder {
+public:
+	// Конструктор
+	DuplicateFinder(size_t numThreads) : pool(numThreads ? numThreads : 1) {}
+
+	/// @brief Добавить найденный файл; вызывается потоками обхода
+	void add(const std::string& path);
+
+	/// @brief Дождаться хеширования и вернуть наборы одинаковых файлов; вызывается после завершения обхода
+	std::vector<DuplicateSet> finish();
+
+private:
+	// Кандидат в дубликаты
+	struct Candidate {
+		// наименьший из путей жестких ссылок на файл
+		std::string path;
+		uint64_t partialHash = 0;
+		uint64_t fullHash = 0;
+		// файл не удалось прочитать
+		bool failed = false;
+	};
+
+	// Пул потоков для stat и хеширования
+	ThreadPool pool;
+	// Мьютекс для синхронизации доступа к группам
+	std::mutex groupsMutex;
+	// Группы кандидатов по размеру
+	std::unordered_map<uint64_t, std::vector<Candidate>> groups;
+	// Размер и номер кандидата для каждого inode; жесткие ссылки не становятся отдельными кандидатами
+	std::unordered_map<FileIdentity, std::pair<uint64_t, size_t>, FileIdentityHash> identities;
+	// Подтвержденные наборы; заполняются в finish
+	std::vector<DuplicateSet> confirmed;
+
+	/// @brief Хеширование первого и последнего блока кандидата
+	void hashPartial(uint64_t size, size_t index);
+	/// @brief Хеширование всего содержимого кандидата
+	void hashFull(uint64_t size, size_t index);
+	/// @brief Разбиение путей с одинаковым хешем на наборы с побайтно равным содержимым
+	void confirm(uint64_t size, std::vector<std::string> paths);
+};
+
+/// @brief Разбиение путей к файлам размера size на наборы с побайтно равным содержимым;
+/// файлы без пары не попадают в результат, пути в наборах упорядочены
+std::vector<DuplicateSet> splitByContent(uint64_t size, std::vector<std::string> paths);
+
+/// @brief Вывод наборов одинаковых файлов
+void printDuplicates(const std::vector<DuplicateSet>& duplicates);
@@ -1,110 +1,30 @@
 ﻿#include <thread>
 #include <vector>
 #include <filesystem>
-#include <chrono>
-#include <queue>
-#include <mutex>
 #include <iostream>
-#include <condition_variable>
 #include <cstring>
 #include <functional>
+#include <memory>
 #include <args_parse/args.hpp>
+#include <args_parse/trace.hpp>
+#include "directory.hpp"
+#include "thread_pool.hpp"
+#include "uring_walker.hpp"
+#include "duplicates.hpp"
+#include "path_pool.hpp"
+#include "visited_set.hpp"
 
-/// @brief Структура для представления дерева каталогов
-struct Directory {
-	// Имя каталога
-	std::string name;
-	// Имена файлов
-	std::vector<std::string> files;
-	// Подкаталоги
-	std::vector<Directory> subdirectories;
-	// Номер потока, который обрабатывал директорию
-	std::thread::id threadId;
-
-	// Конструктор
-	Directory(const std::string& name) : name(name) {}
-};
-
-/// @brief Функция для вывода дерева каталогов
-void printDirectory(const Directory& directory) {
-	// Вывод подкаталогов
-	for (const auto& subdir : directory.subdirectories) {
-		std::cout << "\t" << subdir.name << " (Thread ID: " << subdir.threadId << ")" << std::endl;
-		printDirectory(subdir);
-	}
-	// Вывод файлов
-	for (const auto& file : directory.files) {
-		std::cout << "\t\t" << file << std::endl;
-	}
-}
-/// @brief Класс управления пулом потоков
-class ThreadPool {
-public:
-	// Конструтор
-	ThreadPool(size_t numThreads) : stopped(false) {
-		for (size_t i = 0; i < numThreads; ++i) {
-			workers.emplace_back([this] {
-				while (true) {
-					std::function<void()> task;
-					{
-						std::unique_lock<std::mutex> lock(queueMutex);
-						// Ждем, пока очередь задач не станет непустой или не установлен флаг stopped
-						condition.wait(lock, [this] { return stopped || !tasks.empty(); });
-						// Поток завершает работу, если флаг stop установлен и очередь задач пуста
-						if (stopped && tasks.empty()) return;
-						task = std::move(tasks.front());
-						tasks.pop();
-					}
-					task();
-				}
-				});
-		}
-	}
-
-	/// @brief Метод для добавления задачи в очередь
-	template<class F>
-	void enqueue(F&& f) {
-		{
-			std::unique_lock<std::mutex> lock(queueMutex);
-			tasks.emplace(std::forward<F>(f));
-		}
-		condition.notify_one();
-	}
-
-	/// @brief Деструктор
-	~ThreadPool() {
-		{
-			std::unique_lock<std::mutex> lock(queueMutex);
-			stopped = true;
-		}
-		condition.notify_all(); // Разбудить все потоки, чтобы они могли завершиться
-		for (std::thread& worker : workers) {
-			worker.join();
-		}
-	}
-	/// @brief Метод для проверки, остановлен ли ThreadPool
-	bool isStopped() const {
-		return stopped.load();
-		//return stop;
-	}
-
-private:
-	// Вектор потоков
-	std::vector<std::thread> workers;
-	// Очередь задач
-	std::queue<std::function<void()>> tasks;
-	// Мьютекс для синхронизации доступа к очереди
-	std::mutex queueMutex;
-	// Условная переменная для управления потоками
-	std::condition_variable condition;
-	// Атомарная переменная для определения состояния остановки
-	std::atomic<bool> stopped;
-};
 /// @brief Выполнения задачи обработки каталога
 class Task {
 public:
 	// Конструктор
-	Task(const std::string& path, ThreadPool& pool) : path(path), pool(pool) {}
+	Task(std::string path, ThreadPool& pool, const LinkPolicy& links, DuplicateFinder* duplicates = nullptr)
+		: path(std::move(path)), pool(pool), links(links), duplicates(duplicates), enqueuedAt(args_parse::Trace::enabled() ? args_parse::Trace::now() : 0) {}
+	Task(Task&&) noexcept = default;
+	// Деструктор возвращает буфер пути в PathPool
+	~Task() {
+		PathPool::release(std::move(path));
+	}
 	// Оператор вызова для выполнения задачи
 	void operator()() {
 		processDirectory(path);
@@ -115,40 +35,113 @@ private:
 	std::string path;
 	// Пул потоков
 	ThreadPool& pool;
+	// Обработка ссылок
+	const LinkPolicy& links;
+	// Поиск дубликатов, если он включен
+	DuplicateFinder* duplicates;
+	// Время постановки в очередь для трассировки
+	uint64_t enqueuedAt;
 	/// @brief Обработка каталога
 	void processDirectory(const std::string& path) {
+		args_parse::TraceSpan span("Task::processDirectory");
+		if (span.active()) {
+			span.setDetail(path);
+			span.setArg2("queue_wait_ns", args_parse::Trace::now() - enqueuedAt);
+		}
+		uint64_t entries = 0;
 		std::string directoryName = std::filesystem::path(path).filename().string();
 		Directory directory(directoryName);
 		directory.threadId = std::this_thread::get_id();
-		for (const auto& entry : std::filesystem::directory_iterator(path)) {
-			if (entry.is_directory() && entry.path().filename().string()[0] != '.') {
+		// ошибки чтения учитываются и выводятся, как в UringWalker: исключение в потоке пула завершило бы программу
+		std::error_code error;
+		std::filesystem::directory_iterator iter(path, error);
+		if (error) {
+			reportDirectoryError(path, error.value());
+			return;
+		}
+		for (const std::filesystem::directory_iterator end; iter != end; iter.increment(error)) {
+			if (error)
+				break;
+			const auto& entry = *iter;
+			++entries;
+			std::error_code entryError;
+			if (entry.is_directory(entryError) && entry.path().filename().string()[0] != '.') {
+				// По символическим ссылкам переходим только в режиме followSymlinks, и каждый каталог посещаем один раз
+				if (entry.is_symlink(entryError) && !links.followSymlinks)
+					continue;
+				if (links.followSymlinks && !links.firstVisit(entry.path().native()))
+					continue;
 				// Получаем имя подкаталога
 				std::string subdirName = entry.path().filename().string();
-				// Добавляем задачу для обработки подкаталога в пул
-				pool.enqueue(Task(entry.path().string(), pool));
+				// Добавляем задачу для обработки подкаталога в пул; буфер пути берется из PathPool
+				std::string subdirPath = PathPool::acquire();
+				subdirPath.assign(entry.path().native());
+				pool.enqueue(Task(std::move(subdirPath), pool, links, duplicates));
 				directory.subdirectories.emplace_back(subdirName);
 			}
-			else if (entry.is_regular_file()) {
+			else if (entry.is_regular_file(entryError)) {
+				// Файл с несколькими жесткими ссылками учитываем один раз
+				if (links.dedupeHardlinks && !links.firstLink(entry.path().native()))
+					continue;
 				// Добавляем имя файла в список файлов каталога
 				directory.files.push_back(entry.path().filename().string());
+				// Передаем файл на поиск дубликатов
+				if (duplicates)
+					duplicates->add(entry.path().string());
 			}
 		}
+		// прочитанная до ошибки часть каталога все равно выводится
+		if (error)
+			reportDirectoryError(path, error.value());
+		span.setArg1("entries", entries);
 		// Вывод структуры каталога
-		printDirectory(directory);
+		reportDirectory(directory);
 	}
 };
+// Задача хранится во встроенном буфере пула без обращения к куче
+static_assert(sizeof(Task) <= ThreadPool::TaskCapacity, "Task must fit into the inline storage of ThreadPool");
 
 int main(int argc, const char** argv) {
 	// Парсинг аргументов командной строки
 	args_parse::ArgsParser parser;
 	args_parse::SingleArg<std::string> path('p', "path");
 	args_parse::SingleArg<int> threads('t', "threads");
+	args_parse::SingleArg<std::string> backend('b', "backend");
+	args_parse::SingleArg<int> queueDepth('q', "queue-depth");
+	args_parse::SingleArg<bool> findDuplicates('d', "duplicates");
+	args_parse::SingleArg<int> hashThreads("hash-threads");
+	args_parse::SingleArg<std::string> tracePath("trace");
+	args_parse::SingleArg<bool> quiet("quiet");
+	args_parse::SingleArg<bool> printStats("stats");
+	args_parse::SingleArg<bool> followSymlinks('L', "follow-symlinks");
+	args_parse::SingleArg<bool> dedupeHardlinks("dedupe-hardlinks");
 
 	path.SetDescription("single string argument to set root path");
 	threads.SetDescription("single string argument to set amount of threads");
+	backend.SetDescription("directory walker backend: pool or uring (falls back to pool when io_uring is unavailable)");
+	queueDepth.SetDescription("number of io_uring requests in flight per thread");
+	findDuplicates.SetDescription("report sets of identical files after the walk");
+	hashThreads.SetDescription("number of threads reading and hashing files for duplicate detection");
+	tracePath.SetDescription("write a Chrome trace of directory tasks to the given file at exit");
+	quiet.SetDescription("do not print the directory tree");
+	printStats.SetDescription("print walk counters as a JSON line to stderr");
+	followSymlinks.SetDescription("descend into symlinked directories, visiting every directory once");
+	dedupeHardlinks.SetDescription("list a file with several hard links only once");
+	backend.setChoices({ "pool", "uring" });
+	queueDepth.setRange(1, 4096);
+	hashThreads.setRange(1, 256);
 
 	parser.add(&path);
 	parser.add(&threads);
+	parser.add(&backend);
+	parser.add(&queueDepth);
+	parser.add(&findDuplicates);
+	parser.add(&hashThreads);
+	parser.add(&tracePath);
+	parser.add(&quiet);
+	parser.add(&printStats);
+	parser.add(&followSymlinks);
+	parser.add(&dedupeHardlinks);
 
 	parser.parse(argc, argv);
 	parser.printHelp();
@@ -162,14 +155,66 @@ int main(int argc, const char** argv) {
 		std::cerr << "Error: Not a valid directory\n";
 		return 1;
 	}
-	// Создание пула потоков и задачи для обработки корневого каталога
-	ThreadPool pool(threads.value());
-	Task task(path.value(), pool);
-	// Добавляем задачу в пул
-	pool.enqueue(std::ref(task));
-	//pool.~ThreadPool();
-	while (!pool.isStopped()) {
-		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	const size_t numThreads = threads.isDefined() && threads.value() > 0 ? threads.value() : std::max(1u, std::thread::hardware_concurrency());
+
+	// Трассировка включается до создания задач, чтобы учесть время ожидания корневой задачи
+	args_parse::Trace::enable(tracePath.isDefined());
+	setDirectoryOutput(!quiet.value());
+	// Счетчики захвата мьютекса очереди использованного механизма обхода
+	uint64_t lockAcquisitions = 0;
+	uint64_t lockContended = 0;
+
+	// Множество посещенных каталогов и файлов, общее для всех потоков
+	VisitedSet visited;
+	LinkPolicy links;
+	links.followSymlinks = followSymlinks.value();
+	links.dedupeHardlinks = dedupeHardlinks.value();
+	links.visited = &visited;
+	if (links.followSymlinks)
+		links.firstVisit(path.value());
+
+	// Поиск дубликатов выполняется собственным пулом потоков параллельно с обходом
+	std::unique_ptr<DuplicateFinder> duplicates;
+	if (findDuplicates.value())
+		duplicates = std::make_unique<DuplicateFinder>(hashThreads.isDefined() ? hashThreads.value() : 2);
+
+	// Обход через io_uring; при недоступности io_uring используется пул потоков
+	bool walked = false;
+	if (backend.isDefined() && backend.value() == "uring") {
+		UringWalker walker(numThreads, queueDepth.isDefined() ? queueDepth.value() : 64);
+		walker.setDuplicateFinder(duplicates.get());
+		walker.setLinkPolicy(links);
+		walked = walker.run(path.value());
+		lockAcquisitions = walker.stats().acquisitions;
+		lockContended = walker.stats().contended;
+		if (!walked)
+			std::cerr << "io_uring is unavailable, falling back to the thread pool\n";
+	}
+
+	if (!walked) {
+		// Создание пула потоков и задачи для обработки корневого каталога
+		ThreadPool pool(numThreads);
+		Task task(path.value(), pool, links, duplicates.get());
+		// Добавляем задачу в пул
+		pool.enqueue(std::ref(task));
+		// Ожидаем обработки всех каталогов
+		pool.waitIdle();
+		const LockStats stats = pool.stats();
+		lockAcquisitions = stats.acquisitions;
+		lockContended = stats.contended;
+	}
+
+	if (duplicates)
+		printDuplicates(duplicates->finish());
+	if (printStats.value()) {
+		std::cerr << "{\"directories\":" << walkStats().directories << ",\"files\":" << walkStats().files
+			<< ",\"errors\":" << walkStats().errors
+			<< ",\"lock_acquisitions\":" << lockAcquisitions << ",\"lock_contended\":" << lockContended << "}\n";
+	}
+	if (tracePath.isDefined() && !args_parse::Trace::writeChromeJson(tracePath.value())) {
+		std::cerr << "Error: Cannot write trace file '" << tracePath.value() << "'\n";
+		return 1;
 	}
-	return 0;
-}
\ No newline at end of file
+	// каталоги, которые не удалось прочитать, уже выведены в stderr
+	return walkStats().errors > 0 ? 1 : 0;
+}
@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+/// @brief Повторное использование буферов путей
+/// У каждого потока есть небольшой список свободных строк; излишки и недостача выравниваются
+/// пакетами через общий список, поэтому путь, созданный одним потоком и освобожденный другим, тоже возвращается в оборот.
+class PathPool {
+public:
+	/// @brief Строка с ранее выделенным буфером или пустая строка, если свободных буферов нет
+	static std::string acquire() {
+		Cache& cache = localCache();
+		if (cache.paths.empty())
+			refill(cache);
+		if (cache.paths.empty())
+			return std::string();
+		std::string path = std::move(cache.paths.back());
+		cache.paths.pop_back();
+		path.clear();
+		return path;
+	}
+
+	/// @brief Вернуть буфер строки в список свободных
+	static void release(std::string&& path) {
+		// строки без выделенного буфера возвращать незачем
+		if (path.capacity() <= std::string().capacity())
+			return;
+		Cache& cache = localCache();
+		if (cache.paths.size() == LocalLimit)
+			spill(cache);
+		cache.paths.push_back(std::move(path));
+	}
+
+private:
+	// Размер списка потока и размер пакета обмена с общим списком
+	static constexpr size_t LocalLimit = 64;
+	static constexpr size_t Batch = LocalLimit / 2;
+	// Предельный размер общего списка
+	static constexpr size_t SharedLimit = 64 * 1024;
+
+	// Список свободных строк потока
+	struct Cache {
+		std::vector<std::string> paths;
+		Cache() { paths.reserve(LocalLimit); }
+	};
+
+	static Cache& localCache() {
+		thread_local Cache cache;
+		return cache;
+	}
+
+	static std::mutex& sharedMutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	static std::vector<std::string>& shared() {
+		static std::vector<std::string> paths;
+		return paths;
+	}
+
+	/// @brief Забрать пакет строк из общего списка
+	static void refill(Cache& cache) {
+		std::lock_guard<std::mutex> lock(sharedMutex());
+		auto& paths = shared();
+		for (size_t i = 0; i < Batch && !paths.empty(); ++i) {
+			cache.paths.push_back(std::move(paths.back()));
+			paths.pop_back();
+		}
+	}
+
+	/// @brief Отдать пакет строк в общий список
+	static void spill(Cache& cache) {
+		std::lock_guard<std::mutex> lock(sharedMutex());
+		auto& paths = shared();
+		for (size_t i = 0; i < Batch; ++i) {
+			if (paths.size() < SharedLimit)
+				paths.push_back(std::move(cache.paths.back()));
+			cache.paths.pop_back();
+		}
+	}
+};
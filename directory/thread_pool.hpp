@@ -0,0 +1,258 @@
+﻿#pragma once
+
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/// @brief Перемещаемая задача с фиксированным встроенным буфером
+/// В отличие от std::function не обращается к куче: вызываемый объект должен поместиться в Capacity байт,
+/// что проверяется при компиляции.
+template<size_t Capacity>
+class InlineTask {
+public:
+	InlineTask() = default;
+
+	template<class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineTask>>>
+	InlineTask(F&& f) {
+		using Callable = std::decay_t<F>;
+		static_assert(sizeof(Callable) <= Capacity, "task does not fit into the inline storage");
+		static_assert(alignof(Callable) <= alignof(std::max_align_t), "task alignment is not supported");
+		static_assert(std::is_nothrow_move_constructible_v<Callable>, "task must be nothrow move constructible");
+		new (storage) Callable(std::forward<F>(f));
+		ops = &OpsFor<Callable>;
+	}
+
+	InlineTask(InlineTask&& other) noexcept {
+		moveFrom(other);
+	}
+
+	InlineTask& operator=(InlineTask&& other) noexcept {
+		if (this != &other) {
+			reset();
+			moveFrom(other);
+		}
+		return *this;
+	}
+
+	InlineTask(const InlineTask&) = delete;
+	InlineTask& operator=(const InlineTask&) = delete;
+
+	~InlineTask() {
+		reset();
+	}
+
+	// Оператор вызова для выполнения задачи
+	void operator()() {
+		ops->invoke(storage);
+	}
+
+	explicit operator bool() const { return ops != nullptr; }
+
+	/// @brief Уничтожение вызываемого объекта
+	void reset() {
+		if (ops) {
+			ops->destroy(storage);
+			ops = nullptr;
+		}
+	}
+
+private:
+	// Таблица операций над хранимым объектом
+	struct Ops {
+		void (*invoke)(void*);
+		void (*move)(void* from, void* to);
+		void (*destroy)(void*);
+	};
+
+	template<class Callable>
+	static inline const Ops OpsFor = {
+		[](void* self) { (*static_cast<Callable*>(self))(); },
+		[](void* from, void* to) {
+			new (to) Callable(std::move(*static_cast<Callable*>(from)));
+			static_cast<Callable*>(from)->~Callable();
+		},
+		[](void* self) { static_cast<Callable*>(self)->~Callable(); },
+	};
+
+	alignas(std::max_align_t) unsigned char storage[Capacity];
+	const Ops* ops = nullptr;
+
+	void moveFrom(InlineTask& other) {
+		if (other.ops) {
+			other.ops->move(other.storage, storage);
+			ops = other.ops;
+			other.ops = nullptr;
+		}
+	}
+};
+
+/// @brief Очередь на кольцевом буфере
+/// Буфер растет удвоением и не уменьшается, поэтому после разогрева push и pop не выделяют память.
+template<class T>
+class RingQueue {
+public:
+	RingQueue(size_t capacity = 64) : buffer(roundUp(capacity)) {}
+
+	bool empty() const { return count == 0; }
+	size_t size() const { return count; }
+
+	/// @brief Добавление в конец очереди
+	void push(T&& value) {
+		if (count == buffer.size())
+			grow();
+		buffer[(head + count) & (buffer.size() - 1)] = std::move(value);
+		++count;
+	}
+
+	/// @brief Извлечение из начала очереди
+	T pop() {
+		T value = std::move(buffer[head]);
+		head = (head + 1) & (buffer.size() - 1);
+		--count;
+		return value;
+	}
+
+private:
+	std::vector<T> buffer;
+	size_t head = 0;
+	size_t count = 0;
+
+	static size_t roundUp(size_t capacity) {
+		size_t result = 1;
+		while (result < capacity)
+			result <<= 1;
+		return result;
+	}
+
+	void grow() {
+		std::vector<T> larger(buffer.size() * 2);
+		for (size_t i = 0; i < count; ++i)
+			larger[i] = std::move(buffer[(head + i) & (buffer.size() - 1)]);
+		buffer = std::move(larger);
+		head = 0;
+	}
+};
+
+/// @brief Счетчики захвата мьютекса очереди
+/// Изменяются только под тем мьютексом, который считают, поэтому атомарные операции не нужны;
+/// читать их можно под тем же мьютексом или после остановки потоков.
+struct LockStats {
+	// Все захваты
+	uint64_t acquisitions = 0;
+	// Захваты, при которых мьютекс был занят другим потоком
+	uint64_t contended = 0;
+};
+
+/// @brief Захват мьютекса с учетом конкуренции: сначала try_lock, при неудаче блокирующий захват
+/// Повторные захваты внутри condition_variable::wait не учитываются.
+inline std::unique_lock<std::mutex> lockCounted(std::mutex& mutex, LockStats& stats) {
+	std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+	bool contended = false;
+	if (!lock.owns_lock()) {
+		contended = true;
+		lock.lock();
+	}
+	// мьютекс уже захвачен: счетчики меняются без атомарных операций и без лишней передачи кэш-линии
+	stats.contended += contended;
+	++stats.acquisitions;
+	return lock;
+}
+
+/// @brief Класс управления пулом потоков
+class ThreadPool {
+public:
+	// Размер встроенного буфера задачи
+	static constexpr size_t TaskCapacity = 64;
+	using Job = InlineTask<TaskCapacity>;
+
+	// Конструтор
+	ThreadPool(size_t numThreads) : stopped(false) {
+		for (size_t i = 0; i < numThreads; ++i) {
+			workers.emplace_back([this] {
+				while (true) {
+					Job task;
+					{
+						auto lock = lockCounted(queueMutex, lockStats);
+						// Ждем, пока очередь задач не станет непустой или не установлен флаг stopped
+						condition.wait(lock, [this] { return stopped || !tasks.empty(); });
+						// Поток завершает работу, если флаг stop установлен и очередь задач пуста
+						if (stopped && tasks.empty()) return;
+						task = tasks.pop();
+					}
+					task();
+					task.reset();
+					{
+						// Задача и все поставленные ею задачи учтены в pending, поэтому ноль означает конец обхода
+						auto lock = lockCounted(queueMutex, lockStats);
+						if (--pending == 0)
+							idleCondition.notify_all();
+					}
+				}
+				});
+		}
+	}
+
+	/// @brief Метод для добавления задачи в очередь
+	template<class F>
+	void enqueue(F&& f) {
+		{
+			auto lock = lockCounted(queueMutex, lockStats);
+			tasks.push(Job(std::forward<F>(f)));
+			++pending;
+		}
+		condition.notify_one();
+	}
+
+	/// @brief Ожидание, пока не будут выполнены все задачи, включая добавленные из самих задач
+	void waitIdle() {
+		auto lock = lockCounted(queueMutex, lockStats);
+		idleCondition.wait(lock, [this] { return pending == 0; });
+	}
+
+	/// @brief Деструктор
+	~ThreadPool() {
+		{
+			auto lock = lockCounted(queueMutex, lockStats);
+			stopped = true;
+		}
+		condition.notify_all(); // Разбудить все потоки, чтобы они могли завершиться
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}
+	/// @brief Снимок счетчиков захвата мьютекса очереди; потоки пула могут продолжать их изменять
+	LockStats stats() {
+		std::lock_guard<std::mutex> lock(queueMutex);
+		return lockStats;
+	}
+	/// @brief Метод для проверки, остановлен ли ThreadPool
+	bool isStopped() const {
+		return stopped.load();
+		//return stop;
+	}
+
+private:
+	// Вектор потоков
+	std::vector<std::thread> workers;
+	// Очередь задач
+	RingQueue<Job> tasks;
+	// Мьютекс для синхронизации доступа к очереди
+	std::mutex queueMutex;
+	// Счетчики захвата мьютекса очереди
+	LockStats lockStats;
+	// Условная переменная для управления потоками
+	std::condition_variable condition;
+	// Условная переменная для ожидания завершения всех задач
+	std::condition_variable idleCondition;
+	// Количество поставленных, но еще не выполненных задач
+	size_t pending = 0;
+	// Атомарная переменная для определения состояния остановки
+	std::atomic<bool> stopped;
+};
@@ -0,0 +1,512 @@
+﻿#include "uring_walker.hpp"
+#include "directory.hpp"
+#include "duplicates.hpp"
+#include <args_parse/trace.hpp>
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <filesystem>
+#include <algorithm>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define DIRECTORY_HAS_URING 1
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <sys/sysmacros.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+#ifdef DIRECTORY_HAS_URING
+namespace {
+	/// @brief Кольца отправки и завершения io_uring поверх системных вызовов без liburing
+	class Ring {
+	public:
+		Ring() = default;
+		Ring(const Ring&) = delete;
+		Ring& operator=(const Ring&) = delete;
+
+		~Ring() {
+			if (sqes_)
+				munmap(sqes_, sqesSize_);
+			if (cqRing_ && cqRing_ != sqRing_)
+				munmap(cqRing_, cqRingSize_);
+			if (sqRing_)
+				munmap(sqRing_, sqRingSize_);
+			if (fd_ >= 0)
+				close(fd_);
+		}
+
+		/// @brief Создание кольца и проверка поддержки openat и statx
+		bool init(unsigned entries) {
+			io_uring_params params{};
+			fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+			if (fd_ < 0)
+				return false;
+			if (!supports({ IORING_OP_OPENAT, IORING_OP_STATX }))
+				return false;
+
+			sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+			cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+			if (singleMap)
+				sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+			sqRing_ = map(sqRingSize_, IORING_OFF_SQ_RING);
+			if (!sqRing_)
+				return false;
+			cqRing_ = singleMap ? sqRing_ : map(cqRingSize_, IORING_OFF_CQ_RING);
+			if (!cqRing_)
+				return false;
+			sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+			sqes_ = static_cast<io_uring_sqe*>(map(sqesSize_, IORING_OFF_SQES));
+			if (!sqes_)
+				return false;
+
+			char* sq = static_cast<char*>(sqRing_);
+			sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+			sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+			sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+			sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+			sqEntries_ = params.sq_entries;
+			char* cq = static_cast<char*>(cqRing_);
+			cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+			cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+			cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+			cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+			tail_ = *sqTail_;
+			return true;
+		}
+
+		/// @brief Свободный элемент очереди отправки или nullptr, если очередь заполнена
+		io_uring_sqe* acquire() {
+			const unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+			if (tail_ - head >= sqEntries_)
+				return nullptr;
+			const unsigned index = tail_ & sqMask_;
+			sqArray_[index] = index;
+			++tail_;
+			++unsubmitted_;
+			io_uring_sqe* sqe = &sqes_[index];
+			std::memset(sqe, 0, sizeof(*sqe));
+			return sqe;
+		}
+
+		/// @brief Отправить подготовленные запросы и дождаться хотя бы waitCount завершений
+		bool submit(unsigned waitCount) {
+			__atomic_store_n(sqTail_, tail_, __ATOMIC_RELEASE);
+			while (unsubmitted_ > 0 || waitCount > 0) {
+				const long result = syscall(__NR_io_uring_enter, fd_, unsubmitted_, waitCount,
+					waitCount ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+				if (result < 0) {
+					if (errno == EINTR)
+						continue;
+					return false;
+				}
+				unsubmitted_ -= static_cast<unsigned>(result);
+				waitCount = 0;
+			}
+			return true;
+		}
+
+		/// @brief Обработать все готовые завершения
+		template<typename F>
+		void reap(F&& handler) {
+			unsigned head = *cqHead_;
+			const unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+			for (; head != tail; ++head)
+				handler(cqes_[head & cqMask_]);
+			__atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+		}
+
+	private:
+		int fd_ = -1;
+		void* sqRing_ = nullptr;
+		void* cqRing_ = nullptr;
+		io_uring_sqe* sqes_ = nullptr;
+		size_t sqRingSize_ = 0;
+		size_t cqRingSize_ = 0;
+		size_t sqesSize_ = 0;
+		unsigned* sqHead_ = nullptr;
+		unsigned* sqTail_ = nullptr;
+		unsigned* sqArray_ = nullptr;
+		unsigned sqMask_ = 0;
+		unsigned sqEntries_ = 0;
+		unsigned* cqHead_ = nullptr;
+		unsigned* cqTail_ = nullptr;
+		unsigned cqMask_ = 0;
+		io_uring_cqe* cqes_ = nullptr;
+		// локальный хвост очереди отправки, публикуется в submit
+		unsigned tail_ = 0;
+		unsigned unsubmitted_ = 0;
+
+		void* map(size_t size, off_t offset) {
+			void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+			return address == MAP_FAILED ? nullptr : address;
+		}
+
+		bool supports(std::initializer_list<unsigned> opcodes) {
+			const size_t size = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+			std::unique_ptr<char[]> buffer(new char[size]());
+			auto* probe = reinterpret_cast<io_uring_probe*>(buffer.get());
+			if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, 256) < 0)
+				return false;
+			for (unsigned opcode : opcodes) {
+				if (opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED))
+					return false;
+			}
+			return true;
+		}
+	};
+
+	/// @brief Запись, возвращаемая getdents64
+	struct LinuxDirent64 {
+		uint64_t d_ino;
+		int64_t d_off;
+		unsigned short d_reclen;
+		unsigned char d_type;
+		char d_name[1];
+	};
+
+	// Размер буфера для чтения записей каталога
+	constexpr size_t DirentBufferSize = 64 * 1024;
+	// Дескрипторы, оставляемые вне бюджета каталогов: стандартные потоки, файлы поиска дубликатов, трассировка
+	constexpr size_t ReservedDescriptors = 32;
+	// Повторы openat при EMFILE/ENFILE, когда поток не держит других каталогов; пауза удваивается от 1 мс
+	constexpr unsigned MaxOpenRetries = 12;
+}
+
+/// @brief Асинхронная операция; адрес передается в user_data
+struct UringWalker::Operation {
+	enum Kind { Open, Stat } kind;
+	DirectoryState* state;
+	// номер записи в unresolved для Stat
+	size_t index;
+};
+
+/// @brief Состояние обрабатываемого каталога
+struct UringWalker::DirectoryState {
+	// Запись, тип которой нужно уточнить через statx
+	struct Unresolved {
+		std::string name;
+		// тип из d_type
+		unsigned char type;
+		struct statx stat;
+		Operation operation;
+	};
+
+	std::string path;
+	int fd = -1;
+	// неудачные попытки openat из-за нехватки дескрипторов
+	unsigned openRetries = 0;
+	Directory directory;
+	Operation openOperation{ Operation::Open, this, 0 };
+	std::vector<Unresolved> unresolved;
+	size_t pendingStats = 0;
+	// Интервал от отправки openat до вывода каталога
+	args_parse::TraceSpan span{ "UringWalker::directory" };
+
+	DirectoryState(std::string path) : path(std::move(path)), directory(std::filesystem::path(this->path).filename().string()) {
+		span.setDetail(this->path);
+	}
+};
+
+/// @brief Проверка поддержки io_uring созданием пробного кольца
+bool UringWalker::isAvailable() {
+	Ring ring;
+	return ring.init(1);
+}
+
+/// @brief Обход дерева: кольца создаются заранее, чтобы при ошибке вернуться к пулу потоков до начала обхода
+bool UringWalker::run(const std::string& root) {
+	std::vector<std::unique_ptr<Ring>> rings;
+	for (size_t i = 0; i < numThreads; ++i) {
+		rings.push_back(std::make_unique<Ring>());
+		if (!rings.back()->init(queueDepth))
+			return false;
+	}
+	// бюджет дескрипторов каталогов делится между потоками; кольца тоже занимают по дескриптору
+	rlimit limit{};
+	size_t descriptors = 1024;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+		descriptors = static_cast<size_t>(limit.rlim_cur);
+	const size_t reserved = ReservedDescriptors + numThreads;
+	openLimit = descriptors > reserved + numThreads ? (descriptors - reserved) / numThreads : 1;
+	{
+		auto lock = lockCounted(queueMutex, lockStats);
+		queue.push_back(root);
+		pending = 1;
+	}
+	std::vector<std::thread> workers;
+	for (auto& ring : rings)
+		workers.emplace_back([this, &ring] { worker(ring.get()); });
+	for (std::thread& thread : workers)
+		thread.join();
+	return true;
+}
+
+/// @brief Цикл потока: пополнение кольца каталогами из общей очереди и обработка завершений
+void UringWalker::worker(void* handle) {
+	Ring& ring = *static_cast<Ring*>(handle);
+	std::vector<char> buffer(DirentBufferSize);
+	// операции, ожидающие места в кольце
+	std::deque<Operation*> deferred;
+	std::deque<std::string> paths;
+	std::vector<std::string> subdirectories;
+	unsigned inflight = 0;
+	// каталоги потока от взятия из очереди до вывода; каждый держит не больше одного дескриптора
+	size_t live = 0;
+	size_t limit = openLimit;
+	// openat, отложенные из-за EMFILE/ENFILE до закрытия одного из каталогов потока
+	std::deque<Operation*> blocked;
+	// openat, отложенные из-за дескрипторов других потоков до указанного момента; кольцо тем временем обслуживается
+	struct Parked {
+		Operation* operation;
+		std::chrono::steady_clock::time_point deadline;
+	};
+	std::vector<Parked> parked;
+
+	auto prepare = [this](io_uring_sqe* sqe, Operation* operation) {
+		DirectoryState* state = operation->state;
+		if (operation->kind == Operation::Open) {
+			sqe->opcode = IORING_OP_OPENAT;
+			sqe->fd = AT_FDCWD;
+			sqe->addr = reinterpret_cast<uintptr_t>(state->path.c_str());
+			sqe->open_flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+		}
+		else {
+			auto& entry = state->unresolved[operation->index];
+			sqe->opcode = IORING_OP_STATX;
+			sqe->fd = state->fd;
+			sqe->addr = reinterpret_cast<uintptr_t>(entry.name.c_str());
+			sqe->len = STATX_TYPE | STATX_INO | STATX_NLINK;
+			sqe->off = reinterpret_cast<uintptr_t>(&entry.stat);
+			// тип определяется по цели ссылки; без d_type ссылка на каталог не отличается от каталога,
+			// поэтому, если переход по ссылкам выключен, запись сначала проверяется без разыменования,
+			// а ссылка запрашивается повторно как DT_LNK (см. stated)
+			sqe->statx_flags = entry.type == DT_UNKNOWN && !links.followSymlinks ? AT_SYMLINK_NOFOLLOW : 0;
+		}
+		sqe->user_data = reinterpret_cast<uintptr_t>(operation);
+	};
+
+	// каталог без незавершенных операций: вывод и освобождение; освободившийся дескриптор
+	// достается отложенному openat
+	auto release = [&](DirectoryState* state) {
+		if (state->fd >= 0)
+			close(state->fd);
+		delete state;
+		--live;
+		finish();
+		if (!blocked.empty()) {
+			deferred.push_back(blocked.front());
+			blocked.pop_front();
+		}
+		// дескрипторов снова хватает: предел, сниженный после EMFILE, постепенно возвращается к исходному
+		else if (limit < openLimit) {
+			++limit;
+		}
+	};
+	auto complete = [&](DirectoryState* state) {
+		state->span.setArg1("entries", state->directory.files.size() + state->directory.subdirectories.size());
+		reportDirectory(state->directory);
+		release(state);
+	};
+
+	// тип записи известен: каталоги добавляются в очередь, как в Task::processDirectory
+	auto classify = [&](DirectoryState* state, const std::string& name, bool isDirectory, bool isFile) {
+		if (isDirectory && name[0] != '.') {
+			subdirectories.push_back(state->path + "/" + name);
+			state->directory.subdirectories.emplace_back(name);
+		}
+		else if (isFile) {
+			state->directory.files.push_back(name);
+			if (duplicates)
+				duplicates->add(state->path + "/" + name);
+		}
+	};
+
+	auto opened = [&](DirectoryState* state, int result) {
+		if ((result == -EMFILE || result == -ENFILE) && state->openRetries < MaxOpenRetries) {
+			// дескрипторы заняты каталогами этого потока: меньше открытых каталогов, повтор после закрытия одного из них
+			const size_t holding = live - blocked.size() - parked.size() - 1;
+			if (holding > 0) {
+				limit = holding;
+				blocked.push_back(&state->openOperation);
+				return;
+			}
+			// дескрипторы заняты другими потоками: повтор после паузы, без остановки обработки завершений
+			++state->openRetries;
+			parked.push_back({ &state->openOperation,
+				std::chrono::steady_clock::now() + std::chrono::milliseconds(1u << (state->openRetries - 1)) });
+			return;
+		}
+		if (result < 0) {
+			reportDirectoryError(state->path, -result);
+			release(state);
+			return;
+		}
+		state->fd = result;
+		state->directory.threadId = std::this_thread::get_id();
+		for (;;) {
+			const long size = syscall(SYS_getdents64, state->fd, buffer.data(), buffer.size());
+			if (size < 0)
+				reportDirectoryError(state->path, errno);
+			if (size <= 0)
+				break;
+			for (long offset = 0; offset < size;) {
+				const auto* entry = reinterpret_cast<const LinuxDirent64*>(buffer.data() + offset);
+				offset += entry->d_reclen;
+				const std::string name = entry->d_name;
+				if (name == "." || name == "..")
+					continue;
+				// идентичность нужна для каталогов при переходе по ссылкам и для файлов при учете жестких ссылок
+				const bool needsIdentity = (entry->d_type == DT_DIR && links.followSymlinks && name[0] != '.')
+					|| (entry->d_type == DT_REG && links.dedupeHardlinks);
+				if (entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN || needsIdentity)
+					state->unresolved.push_back({ name, entry->d_type, {}, { Operation::Stat, state, state->unresolved.size() } });
+				else
+					classify(state, name, entry->d_type == DT_DIR, entry->d_type == DT_REG);
+			}
+		}
+		push(subdirectories);
+		if (state->unresolved.empty()) {
+			complete(state);
+			return;
+		}
+		state->pendingStats = state->unresolved.size();
+		for (auto& entry : state->unresolved)
+			deferred.push_back(&entry.operation);
+	};
+
+	auto stated = [&](Operation* operation, int result) {
+		DirectoryState* state = operation->state;
+		auto& entry = state->unresolved[operation->index];
+		// запись без d_type оказалась ссылкой: цель запрашивается повторно, и ссылка на файл учитывается,
+		// как в обходе пулом потоков, а ссылка на каталог отбрасывается по правилу для DT_LNK ниже
+		if (result == 0 && entry.type == DT_UNKNOWN && S_ISLNK(entry.stat.stx_mode)) {
+			entry.type = DT_LNK;
+			deferred.push_back(operation);
+			return;
+		}
+		if (result == 0) {
+			const uint64_t device = makedev(entry.stat.stx_dev_major, entry.stat.stx_dev_minor);
+			bool isDirectory = S_ISDIR(entry.stat.stx_mode) && entry.name[0] != '.';
+			bool isFile = S_ISREG(entry.stat.stx_mode);
+			// каталоги по ссылкам только в режиме followSymlinks, каждый каталог один раз
+			if (isDirectory && entry.type == DT_LNK && !links.followSymlinks)
+				isDirectory = false;
+			if (isDirectory && links.followSymlinks && !links.visited->insert(device, entry.stat.stx_ino))
+				isDirectory = false;
+			// файл с несколькими жесткими ссылками учитывается один раз
+			if (isFile && links.dedupeHardlinks && entry.stat.stx_nlink > 1 && !links.visited->insert(device, entry.stat.stx_ino))
+				isFile = false;
+			classify(state, entry.name, isDirectory, isFile);
+		}
+		push(subdirectories);
+		if (--state->pendingStats == 0)
+			complete(state);
+	};
+
+	while (true) {
+		// отложенные openat, у которых истекла пауза, снова отправляются
+		if (!parked.empty()) {
+			const auto now = std::chrono::steady_clock::now();
+			auto expired = std::stable_partition(parked.begin(), parked.end(), [&](const Parked& item) { return item.deadline > now; });
+			for (auto item = expired; item != parked.end(); ++item)
+				deferred.push_back(item->operation);
+			parked.erase(expired, parked.end());
+		}
+		// новые каталоги берутся, только если есть место для запросов и дескрипторов
+		size_t room = inflight + deferred.size() < queueDepth ? queueDepth - inflight - deferred.size() : 0;
+		room = std::min(room, live < limit ? limit - live : 0);
+		if (room > 0 && !take(paths, room, inflight == 0 && deferred.empty() && blocked.empty() && parked.empty()))
+			return;
+		while (!paths.empty()) {
+			auto* state = new DirectoryState(std::move(paths.front()));
+			paths.pop_front();
+			deferred.push_back(&state->openOperation);
+			++live;
+		}
+		while (!deferred.empty() && inflight < queueDepth) {
+			io_uring_sqe* sqe = ring.acquire();
+			if (!sqe)
+				break;
+			prepare(sqe, deferred.front());
+			deferred.pop_front();
+			++inflight;
+		}
+		if (inflight == 0) {
+			// в кольце ничего нет, поэтому ожидание отложенного openat ничего не задерживает
+			if (!parked.empty()) {
+				auto earliest = std::min_element(parked.begin(), parked.end(),
+					[](const Parked& left, const Parked& right) { return left.deadline < right.deadline; });
+				std::this_thread::sleep_until(earliest->deadline);
+			}
+			continue;
+		}
+		if (!ring.submit(1))
+			return;
+		ring.reap([&](const io_uring_cqe& cqe) {
+			--inflight;
+			auto* operation = reinterpret_cast<Operation*>(static_cast<uintptr_t>(cqe.user_data));
+			if (operation->kind == Operation::Open)
+				opened(operation->state, cqe.res);
+			else
+				stated(operation, cqe.res);
+			});
+	}
+}
+#else
+bool UringWalker::isAvailable() {
+	return false;
+}
+
+bool UringWalker::run(const std::string&) {
+	return false;
+}
+
+void UringWalker::worker(void*) {}
+#endif
+
+/// @brief Взять каталоги из общей очереди
+bool UringWalker::take(std::deque<std::string>& paths, size_t count, bool wait) {
+	auto lock = lockCounted(queueMutex, lockStats);
+	if (wait) {
+		condition.wait(lock, [this] { return !queue.empty() || pending == 0; });
+		if (queue.empty())
+			return false;
+	}
+	for (; count > 0 && !queue.empty(); --count) {
+		paths.push_back(std::move(queue.front()));
+		queue.pop_front();
+	}
+	return true;
+}
+
+/// @brief Добавить подкаталоги в общую очередь одной блокировкой
+void UringWalker::push(std::vector<std::string>& paths) {
+	if (paths.empty())
+		return;
+	{
+		auto lock = lockCounted(queueMutex, lockStats);
+		pending += paths.size();
+		for (auto& path : paths)
+			queue.push_back(std::move(path));
+	}
+	paths.clear();
+	condition.notify_all();
+}
+
+/// @brief Отметить каталог обработанным; последний каталог будит ожидающие потоки
+void UringWalker::finish() {
+	auto lock = lockCounted(queueMutex, lockStats);
+	if (--pending == 0)
+		condition.notify_all();
+}
@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include "thread_pool.hpp"
+#include "visited_set.hpp"
+
+class DuplicateFinder;
+
+/// @brief Обход дерева каталогов через io_uring
+/// Каждый поток владеет своим кольцом и держит в полете до queueDepth запросов openat/statx,
+/// поэтому нескольким потокам не нужно блокироваться на каждом системном вызове.
+/// Чтение записей каталога (getdents64) выполняется синхронно: io_uring не поддерживает эту операцию.
+/// statx запрашивается только для записей, тип которых не известен из d_type (символические ссылки, DT_UNKNOWN),
+/// а также для каталогов и файлов, идентичность которых нужна LinkPolicy.
+/// Дескриптор каталога держится до завершения statx его записей, поэтому число открытых каталогов
+/// ограничено лимитом дескрипторов, а openat, завершившийся EMFILE/ENFILE, повторяется позже.
+class UringWalker {
+public:
+	// Конструктор
+	UringWalker(size_t numThreads, unsigned queueDepth) : numThreads(numThreads ? numThreads : 1), queueDepth(queueDepth ? queueDepth : 1) {}
+
+	/// @brief Проверка, что ядро поддерживает io_uring и нужные операции
+	static bool isAvailable();
+
+	/// @brief Передавать найденные файлы на поиск дубликатов
+	void setDuplicateFinder(DuplicateFinder* finder) { duplicates = finder; }
+
+	/// @brief Обработка символических и жестких ссылок
+	void setLinkPolicy(const LinkPolicy& policy) { links = policy; }
+
+	/// @brief Счетчики захвата мьютекса общей очереди; читаются после run, когда потоки завершены
+	const LockStats& stats() const { return lockStats; }
+
+	/// @brief Обход дерева от корня с выводом каждого каталога; возвращает false, если io_uring недоступен
+	bool run(const std::string& root);
+
+private:
+	struct DirectoryState;
+	struct Operation;
+
+	// Количество потоков
+	size_t numThreads;
+	// Максимальное количество запросов в полете на поток
+	unsigned queueDepth;
+	// Максимальное количество каталогов, открытых одним потоком; вычисляется в run по RLIMIT_NOFILE
+	size_t openLimit = 1;
+	// Поиск дубликатов, если он включен
+	DuplicateFinder* duplicates = nullptr;
+	// Обработка ссылок
+	LinkPolicy links;
+	// Общая очередь каталогов, ожидающих обработки
+	std::deque<std::string> queue;
+	// Количество каталогов в очереди и в обработке
+	size_t pending = 0;
+	// Мьютекс для синхронизации доступа к очереди
+	std::mutex queueMutex;
+	// Счетчики захвата мьютекса общей очереди
+	LockStats lockStats;
+	// Условная переменная для ожидания новых каталогов
+	std::condition_variable condition;
+
+	/// @brief Цикл обработки одного потока
+	void worker(void* ring);
+	/// @brief Взять до count каталогов из очереди; при wait ожидать, пока появится каталог или обход завершится
+	bool take(std::deque<std::string>& paths, size_t count, bool wait);
+	/// @brief Добавить подкаталоги в общую очередь
+	void push(std::vector<std::string>& paths);
+	/// @brief Отметить каталог обработанным
+	void finish();
+};
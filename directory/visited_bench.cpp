@@ -0,0 +1,64 @@
+﻿#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "visited_set.hpp"
+
+/// @brief Результат одного прогона
+struct Measurement {
+	double seconds;
+	uint64_t contended;
+};
+
+/// @brief Вставка inserts идентичностей каждым из threads потоков; каждая четвертая вставка повторная, как при обходе ссылок
+static Measurement measure(size_t shards, size_t threads, size_t inserts) {
+	VisitedSet visited(shards);
+	std::atomic<size_t> ready{ 0 };
+	std::atomic<bool> go{ false };
+	std::vector<std::thread> workers;
+	for (size_t thread = 0; thread < threads; ++thread) {
+		workers.emplace_back([&, thread] {
+			++ready;
+			while (!go.load(std::memory_order_acquire))
+				std::this_thread::yield();
+			const uint64_t base = static_cast<uint64_t>(thread) * inserts;
+			for (size_t i = 0; i < inserts; ++i) {
+				// соседние номера inode, как у файлов одного каталога
+				const uint64_t inode = base + (i % 4 == 3 ? i - 3 : i);
+				visited.insert(1, inode);
+			}
+			});
+	}
+	while (ready.load() != threads)
+		std::this_thread::yield();
+	const auto start = std::chrono::steady_clock::now();
+	go.store(true, std::memory_order_release);
+	for (std::thread& worker : workers)
+		worker.join();
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return { seconds, visited.contended() };
+}
+
+int main(int argc, char** argv) {
+	const size_t inserts = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+	const size_t maxThreads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 16;
+
+	// Один сегмент соответствует множеству под общим мьютексом
+	std::cout << "{\"inserts_per_thread\":" << inserts << ",\"hardware_threads\":" << std::thread::hardware_concurrency() << ",\"runs\":[";
+	bool first = true;
+	for (size_t shards : { size_t(1), size_t(64) }) {
+		for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+			const Measurement result = measure(shards, threads, inserts);
+			const double total = static_cast<double>(threads * inserts);
+			std::cout << (first ? "" : ",") << "\n{\"shards\":" << shards << ",\"threads\":" << threads
+				<< ",\"inserts_per_second\":" << static_cast<uint64_t>(total / result.seconds)
+				<< ",\"ns_per_insert_per_thread\":" << result.seconds * 1e9 / inserts
+				<< ",\"contended_fraction\":" << result.contended / total << "}";
+			first = false;
+		}
+	}
+	std::cout << "\n]}\n";
+	return 0;
+}
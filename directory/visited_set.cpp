@@ -0,0 +1,71 @@
+﻿#include "visited_set.hpp"
+
+#include <sys/stat.h>
+
+/// @brief Перемешивание битов (финализатор splitmix64)
+static uint64_t mix(uint64_t value) {
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+	return value ^ (value >> 31);
+}
+
+size_t FileIdentityHash::operator()(const FileIdentity& identity) const {
+	return static_cast<size_t>(mix(identity.inode ^ mix(identity.device)));
+}
+
+/// @brief Конструктор
+VisitedSet::VisitedSet(size_t shardCount) {
+	size_t count = 1;
+	while (count < shardCount)
+		count <<= 1;
+	shards.reset(new Shard[count]);
+	shardMask = count - 1;
+}
+
+/// @brief Добавить идентичность: сегмент выбирается по старшим битам хеша, младшие использует unordered_set
+bool VisitedSet::insert(uint64_t device, uint64_t inode) {
+	const FileIdentity identity{ device, inode };
+	Shard& shard = shards[(FileIdentityHash()(identity) >> 48) & shardMask];
+	std::unique_lock<std::mutex> lock(shard.mutex, std::try_to_lock);
+	if (!lock.owns_lock()) {
+		lock.lock();
+		++shard.contended;
+	}
+	return shard.identities.insert(identity).second;
+}
+
+/// @brief Количество добавленных идентичностей
+size_t VisitedSet::size() const {
+	size_t total = 0;
+	for (size_t i = 0; i <= shardMask; ++i) {
+		std::lock_guard<std::mutex> lock(shards[i].mutex);
+		total += shards[i].identities.size();
+	}
+	return total;
+}
+
+/// @brief Количество вставок, ожидавших мьютекс сегмента
+uint64_t VisitedSet::contended() const {
+	uint64_t total = 0;
+	for (size_t i = 0; i <= shardMask; ++i) {
+		std::lock_guard<std::mutex> lock(shards[i].mutex);
+		total += shards[i].contended;
+	}
+	return total;
+}
+
+/// @brief Первое посещение каталога; недоступный каталог считается уже посещенным
+bool LinkPolicy::firstVisit(const std::string& path) const {
+	struct stat status;
+	if (::stat(path.c_str(), &status) != 0)
+		return false;
+	return visited->insert(static_cast<uint64_t>(status.st_dev), static_cast<uint64_t>(status.st_ino));
+}
+
+/// @brief Первая встреча файла
+bool LinkPolicy::firstLink(const std::string& path) const {
+	struct stat status;
+	if (::stat(path.c_str(), &status) != 0 || status.st_nlink <= 1)
+		return true;
+	return visited->insert(static_cast<uint64_t>(status.st_dev), static_cast<uint64_t>(status.st_ino));
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <string>
+
+/// @brief Идентичность файла или каталога: устройство и номер inode
+struct FileIdentity {
+	uint64_t device;
+	uint64_t inode;
+
+	bool operator==(const FileIdentity& other) const { return device == other.device && inode == other.inode; }
+};
+
+/// @brief Хеш идентичности с перемешиванием, чтобы соседние inode попадали в разные сегменты
+struct FileIdentityHash {
+	size_t operator()(const FileIdentity& identity) const;
+};
+
+/// @brief Потокобезопасное множество посещенных файлов и каталогов
+/// Множество разделено на сегменты со своими мьютексами; сегмент выбирается по хешу идентичности,
+/// поэтому потоки, вставляющие разные inode, почти никогда не ждут друг друга.
+class VisitedSet {
+public:
+	// Конструктор; количество сегментов округляется вверх до степени двойки
+	VisitedSet(size_t shardCount = 64);
+
+	/// @brief Добавить идентичность; false, если она уже была добавлена
+	bool insert(uint64_t device, uint64_t inode);
+	/// @brief Количество добавленных идентичностей
+	size_t size() const;
+	/// @brief Количество вставок, при которых мьютекс сегмента был занят другим потоком
+	uint64_t contended() const;
+
+private:
+	// Сегмент на отдельной кэш-линии, чтобы сегменты не мешали друг другу
+	struct alignas(64) Shard {
+		mutable std::mutex mutex;
+		std::unordered_set<FileIdentity, FileIdentityHash> identities;
+		// изменяется только под мьютексом сегмента
+		uint64_t contended = 0;
+	};
+
+	std::unique_ptr<Shard[]> shards;
+	size_t shardMask;
+};
+
+/// @brief Обработка ссылок при обходе, общая для всех потоков
+struct LinkPolicy {
+	// Переходить в каталоги по символическим ссылкам; каждый каталог посещается один раз
+	bool followSymlinks = false;
+	// Учитывать файл с несколькими жесткими ссылками один раз
+	bool dedupeHardlinks = false;
+	// Множество посещенных каталогов и файлов; нужно, если включен хотя бы один из режимов
+	VisitedSet* visited = nullptr;
+
+	/// @brief Первое посещение каталога по пути (ссылки разыменовываются)
+	bool firstVisit(const std::string& path) const;
+	/// @brief Первая встреча файла; файлы с единственной жесткой ссылкой не запоминаются
+	bool firstLink(const std::string& path) const;
+};
@@ -0,0 +1,372 @@
+﻿#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <args_parse/args.hpp>
+
+/// @brief Детерминированный генератор псевдослучайных чисел (splitmix64), одинаковый на всех платформах
+class Random {
+public:
+	Random(uint64_t seed) : state(seed) {}
+
+	uint64_t next() {
+		uint64_t value = (state += 0x9E3779B97F4A7C15ULL);
+		value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+		return value ^ (value >> 31);
+	}
+
+	// число в диапазоне [0, bound)
+	uint64_t below(uint64_t bound) { return next() % bound; }
+	// число в диапазоне (0, 1]
+	double unit() { return static_cast<double>((next() >> 11) + 1) / static_cast<double>(1ULL << 53); }
+
+private:
+	uint64_t state;
+};
+
+/// @brief Построение синтетического дерева заданной формы и размера
+/// Одинаковые форма, размер и seed всегда дают одинаковое дерево.
+class TreeGenerator {
+public:
+	TreeGenerator(const std::filesystem::path& root, uint64_t entries, uint64_t seed) : root(root), budget(entries), random(seed) {}
+
+	/// @brief Построение дерева; shape: deep, wide, small или skewed
+	bool generate(const std::string& shape) {
+		std::error_code error;
+		std::filesystem::create_directories(root, error);
+		if (error)
+			return false;
+		if (shape == "deep")
+			deep();
+		else if (shape == "wide")
+			wide();
+		else if (shape == "small")
+			breadthFirst(8, 32, false);
+		else
+			skewed();
+		return ok;
+	}
+
+private:
+	std::filesystem::path root;
+	// Сколько записей (каталогов и файлов) осталось создать
+	uint64_t budget;
+	Random random;
+	bool ok = true;
+	std::vector<char> content;
+
+	bool createDirectory(const std::filesystem::path& path) {
+		if (budget == 0)
+			return false;
+		--budget;
+		if (::mkdir(path.c_str(), 0755) != 0 && errno != EEXIST)
+			ok = false;
+		return true;
+	}
+
+	bool createFile(const std::filesystem::path& path, size_t size) {
+		if (budget == 0)
+			return false;
+		--budget;
+		const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0) {
+			ok = false;
+			return true;
+		}
+		if (size > 0) {
+			if (content.size() < size) {
+				content.resize(size);
+				for (char& c : content)
+					c = static_cast<char>('a' + random.below(26));
+			}
+			if (::write(fd, content.data(), size) != static_cast<ssize_t>(size))
+				ok = false;
+		}
+		::close(fd);
+		return true;
+	}
+
+	static std::string name(char prefix, uint64_t index) {
+		return prefix + std::to_string(index);
+	}
+
+	/// @brief Глубокое узкое дерево: цепочки по 256 уровней, на каждом уровне три файла
+	void deep() {
+		for (uint64_t chain = 0; budget > 0; ++chain) {
+			std::filesystem::path path = root / name('c', chain);
+			if (!createDirectory(path))
+				return;
+			for (uint64_t level = 0; level < 256 && budget > 0; ++level) {
+				for (uint64_t file = 0; file < 3; ++file)
+					createFile(path / name('f', file), 0);
+				path /= name('d', level);
+				if (!createDirectory(path))
+					return;
+			}
+		}
+	}
+
+	/// @brief Широкое плоское дерево: немного каталогов с тысячами файлов в каждом
+	void wide() {
+		const uint64_t directories = std::max<uint64_t>(1, budget / 5000);
+		const uint64_t filesPerDirectory = budget / directories;
+		for (uint64_t directory = 0; directory < directories && budget > 0; ++directory) {
+			const std::filesystem::path path = root / name('d', directory);
+			createDirectory(path);
+			for (uint64_t file = 0; file < filesPerDirectory && budget > 0; ++file)
+				createFile(path / name('f', file), 0);
+		}
+	}
+
+	/// @brief Сбалансированное дерево обходом в ширину; small создает небольшие непустые файлы
+	void breadthFirst(uint64_t fanout, uint64_t files, bool empty) {
+		std::deque<std::filesystem::path> queue{ root };
+		uint64_t extra = 0;
+		while (budget > 0) {
+			if (queue.empty()) {
+				queue.push_back(root / name('x', extra++));
+				createDirectory(queue.back());
+			}
+			const std::filesystem::path path = std::move(queue.front());
+			queue.pop_front();
+			for (uint64_t file = 0; file < files && budget > 0; ++file)
+				createFile(path / name('f', file), empty ? 0 : 1 + random.below(4096));
+			for (uint64_t directory = 0; directory < fanout && budget > 0; ++directory) {
+				queue.push_back(path / name('d', directory));
+				createDirectory(queue.back());
+			}
+		}
+	}
+
+	/// @brief Неравномерное дерево: число файлов и подкаталогов распределено с тяжелым хвостом
+	void skewed() {
+		std::deque<std::filesystem::path> queue{ root };
+		uint64_t extra = 0;
+		while (budget > 0) {
+			if (queue.empty()) {
+				queue.push_back(root / name('x', extra++));
+				createDirectory(queue.back());
+			}
+			const std::filesystem::path path = std::move(queue.front());
+			queue.pop_front();
+			const uint64_t files = std::min<uint64_t>(100000, static_cast<uint64_t>(2.0 / std::pow(random.unit(), 1.2)));
+			for (uint64_t file = 0; file < files && budget > 0; ++file)
+				createFile(path / name('f', file), 0);
+			const uint64_t directories = random.below(10) == 0 ? 20 + random.below(20) : random.below(4);
+			for (uint64_t directory = 0; directory < directories && budget > 0; ++directory) {
+				queue.push_back(path / name('d', directory));
+				createDirectory(queue.back());
+			}
+		}
+	}
+};
+
+/// @brief Результат одного запуска обхода
+struct RunResult {
+	bool ok = false;
+	double seconds = 0;
+	long peakRssKb = 0;
+	uint64_t directories = 0;
+	uint64_t files = 0;
+	uint64_t lockAcquisitions = 0;
+	uint64_t lockContended = 0;
+};
+
+/// @brief значение числового поля из строки счетчиков вида {"name":value,...}
+static uint64_t jsonField(const std::string& line, const std::string& name) {
+	const std::string key = "\"" + name + "\":";
+	const size_t position = line.find(key);
+	return position == std::string::npos ? 0 : std::strtoull(line.c_str() + position + key.size(), nullptr, 10);
+}
+
+/// @brief Запуск обхода в дочернем процессе: время, пиковая память по wait4 и счетчики из stderr
+static RunResult runWalker(const std::string& walker, const std::vector<std::string>& arguments) {
+	RunResult result;
+	int pipeFds[2];
+	if (pipe(pipeFds) != 0)
+		return result;
+	std::vector<char*> argv;
+	argv.push_back(const_cast<char*>(walker.c_str()));
+	for (const auto& argument : arguments)
+		argv.push_back(const_cast<char*>(argument.c_str()));
+	argv.push_back(nullptr);
+
+	const auto start = std::chrono::steady_clock::now();
+	const pid_t pid = fork();
+	if (pid == 0) {
+		const int devNull = ::open("/dev/null", O_WRONLY);
+		dup2(devNull, 1);
+		dup2(pipeFds[1], 2);
+		close(pipeFds[0]);
+		execv(walker.c_str(), argv.data());
+		_exit(127);
+	}
+	close(pipeFds[1]);
+	if (pid < 0) {
+		close(pipeFds[0]);
+		return result;
+	}
+	std::string output;
+	char buffer[4096];
+	for (ssize_t count; (count = read(pipeFds[0], buffer, sizeof(buffer))) > 0;)
+		output.append(buffer, static_cast<size_t>(count));
+	close(pipeFds[0]);
+
+	int status = 0;
+	struct rusage usage{};
+	wait4(pid, &status, 0, &usage);
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.peakRssKb = usage.ru_maxrss;
+	result.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+	const size_t line = output.rfind("{\"directories\"");
+	if (line == std::string::npos) {
+		result.ok = false;
+		return result;
+	}
+	const std::string stats = output.substr(line);
+	result.directories = jsonField(stats, "directories");
+	result.files = jsonField(stats, "files");
+	result.lockAcquisitions = jsonField(stats, "lock_acquisitions");
+	result.lockContended = jsonField(stats, "lock_contended");
+	return result;
+}
+
+/// @brief Сброс страничного кэша для замеров на холодном кэше; требует прав root
+static bool dropCaches() {
+	sync();
+	std::ofstream file("/proc/sys/vm/drop_caches");
+	return file && (file << "3\n") && file.flush();
+}
+
+int main(int argc, const char** argv) {
+	args_parse::ArgsParser parser;
+	args_parse::SingleArg<std::string> shape('s', "shape");
+	args_parse::SingleArg<int> entries('n', "entries");
+	args_parse::SingleArg<int> seed("seed");
+	args_parse::SingleArg<std::string> root('r', "root");
+	args_parse::MultiArg<int> threads('t', "threads");
+	args_parse::SingleArg<std::string> backend('b', "backend");
+	args_parse::SingleArg<int> repeat("repeat");
+	args_parse::SingleArg<std::string> walker('w', "walker");
+	args_parse::SingleArg<bool> regenerate("regenerate");
+	args_parse::SingleArg<bool> coldCache("drop-caches");
+
+	shape.SetDescription("tree shape: deep, wide, small or skewed (default small)");
+	entries.SetDescription("number of directories and files to generate (default 100000)");
+	seed.SetDescription("generator seed (default 1)");
+	root.SetDescription("directory for the generated tree, e.g. on tmpfs (default: system temp directory)");
+	threads.SetDescription("thread counts to run, e.g. 1,2,4,8 or 1-8 (default 1,2,4,8)");
+	backend.SetDescription("walker backend: pool or uring (default pool)");
+	repeat.SetDescription("runs per thread count, the fastest is reported (default 3)");
+	walker.SetDescription("path to the directory executable (default: next to this program)");
+	regenerate.SetDescription("rebuild the tree even if a matching one exists");
+	coldCache.SetDescription("drop the page cache before every run (requires root)");
+	shape.setChoices({ "deep", "wide", "small", "skewed" });
+	entries.setRange(1, 100000000);
+	threads.setRange(1, 1024);
+	backend.setChoices({ "pool", "uring" });
+	repeat.setRange(1, 100);
+
+	for (args_parse::Arg* arg : std::initializer_list<args_parse::Arg*>{ &shape, &entries, &seed, &root, &threads, &backend, &repeat, &walker, &regenerate, &coldCache })
+		parser.add(arg);
+	parser.parse(argc, argv);
+	if (!parser.diagnostics().empty()) {
+		parser.printHelp();
+		return 1;
+	}
+
+	const std::string shapeName = shape.isDefined() ? shape.value() : "small";
+	const uint64_t entryCount = entries.isDefined() ? entries.value() : 100000;
+	const uint64_t seedValue = seed.isDefined() ? seed.value() : 1;
+	// диапазоны вида 1-8 разворачиваются в порядке командной строки; их размер ограничен setRange
+	const std::vector<int> threadCounts = threads.isDefined() ? threads.values() : std::vector<int>{ 1, 2, 4, 8 };
+	const std::string backendName = backend.isDefined() ? backend.value() : "pool";
+	const int repeats = repeat.isDefined() ? repeat.value() : 3;
+	const std::string walkerPath = walker.isDefined() ? walker.value()
+		: (std::filesystem::path(argv[0]).parent_path() / "directory").string();
+	const std::filesystem::path treeRoot = root.isDefined() ? std::filesystem::path(root.value())
+		: std::filesystem::temp_directory_path() / ("walk_bench_" + shapeName + "_" + std::to_string(entryCount) + "_" + std::to_string(seedValue));
+
+	// Дерево переиспользуется, если рядом лежит описание с теми же параметрами
+	const std::string manifestPath = treeRoot.string() + ".manifest";
+	const std::string manifest = shapeName + " " + std::to_string(entryCount) + " " + std::to_string(seedValue) + "\n";
+	std::string existing;
+	{
+		std::ifstream file(manifestPath);
+		std::getline(file, existing);
+		existing += "\n";
+	}
+	if (regenerate.value() || existing != manifest || !std::filesystem::is_directory(treeRoot)) {
+		std::error_code error;
+		std::filesystem::remove_all(treeRoot, error);
+		std::filesystem::remove(manifestPath, error);
+		const auto start = std::chrono::steady_clock::now();
+		if (!TreeGenerator(treeRoot, entryCount, seedValue).generate(shapeName)) {
+			std::cerr << "Error: Cannot generate tree in '" << treeRoot.string() << "'\n";
+			return 1;
+		}
+		std::ofstream(manifestPath) << manifest;
+		std::cerr << "generated " << entryCount << " entries in " << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s\n";
+	}
+
+	bool cold = coldCache.value();
+	std::ostringstream json;
+	json << "{\"shape\":\"" << shapeName << "\",\"entries\":" << entryCount << ",\"seed\":" << seedValue
+		<< ",\"root\":\"" << treeRoot.string() << "\",\"backend\":\"" << backendName << "\",\"repeat\":" << repeats << ",\"runs\":[";
+	double baseSeconds = 0;
+	int baseThreads = 0;
+	for (size_t i = 0; i < threadCounts.size(); ++i) {
+		const int threadCount = threadCounts[i];
+		RunResult best;
+		for (int run = 0; run < repeats; ++run) {
+			if (cold && !dropCaches()) {
+				std::cerr << "warning: cannot drop the page cache, measuring with a warm cache\n";
+				cold = false;
+			}
+			const RunResult result = runWalker(walkerPath, { "-p", treeRoot.string(), "-t", std::to_string(threadCount),
+				"-b", backendName, "--quiet=true", "--stats=true" });
+			if (!result.ok) {
+				std::cerr << "Error: Walker '" << walkerPath << "' failed\n";
+				return 1;
+			}
+			if (!best.ok || result.seconds < best.seconds)
+				best = result;
+		}
+		if (i == 0) {
+			baseSeconds = best.seconds;
+			baseThreads = threadCount;
+		}
+		// эффективность масштабирования относительно первого количества потоков
+		const double speedup = baseSeconds / best.seconds;
+		const double efficiency = speedup / (static_cast<double>(threadCount) / baseThreads);
+		const uint64_t visited = best.directories + best.files;
+		json << (i ? "," : "") << "\n{\"threads\":" << threadCount
+			<< ",\"seconds\":" << best.seconds
+			<< ",\"directories\":" << best.directories
+			<< ",\"files\":" << best.files
+			<< ",\"entries_per_second\":" << static_cast<uint64_t>(visited / best.seconds)
+			<< ",\"peak_rss_kb\":" << best.peakRssKb
+			<< ",\"lock_acquisitions\":" << best.lockAcquisitions
+			<< ",\"lock_contended\":" << best.lockContended
+			<< ",\"speedup\":" << speedup
+			<< ",\"efficiency\":" << efficiency << "}";
+	}
+	json << "\n],\"cold_cache\":" << (cold ? "true" : "false") << "}\n";
+	std::cout << json.str();
+	return 0;
+}
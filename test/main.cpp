@@ -1,8 +1,23 @@
-#include <catch2/catch_all.hpp>
+﻿#include <catch2/catch_all.hpp>
 #include <args_parse/args.hpp>
 #include <args_parse/validator.hpp>
+#include <args_parse/completion.hpp>
+#include <args_parse/static_parser.hpp>
+#include <args_parse/batch.hpp>
+#include <args_parse/snapshot.hpp>
+#include <args_parse/trace.hpp>
+#include <directory/duplicates.hpp>
+#include <directory/visited_set.hpp>
 #include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
 #include <memory>
+#include <thread>
+#include <atomic>
 #include <unordered_map>
 
 TEST_CASE("Validation of arguments", "[args_validation]") {
@@ -243,4 +258,1040 @@ TEST_CASE("Parsing multi arguments", "[multi_parse]") {
 		REQUIRE(values[1] == "value2");
 		REQUIRE(values[2] == "value3");
 	}
-}
\ No newline at end of file
+}
+
+TEST_CASE("Parsing delimited lists and ranges", "[multi_list_parse]") {
+	args_parse::ArgsParser parser;
+
+	SECTION("Parsing of MultiInt comma separated list") {
+		args_parse::MultiArg<int> arg('i', "ids");
+		parser.add(&arg);
+
+		const char* argv[] = { "args_parse_demo", "--ids=1,2,3", "-i4,5" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		const auto& values = arg.values();
+		REQUIRE(values.size() == 5);
+		REQUIRE(values[0] == 1);
+		REQUIRE(values[2] == 3);
+		REQUIRE(values[4] == 5);
+	}
+	SECTION("Parsing of MultiInt range") {
+		args_parse::MultiArg<int> arg('s', "shards");
+		parser.add(&arg);
+
+		const char* argv[] = { "args_parse_demo", "--shards=0-4095,5000" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE(arg.singles().size() == 1);
+		REQUIRE(arg.values().size() == 4097);
+		REQUIRE(arg.ranges().size() == 1);
+		REQUIRE(arg.ranges()[0].first() == 0);
+		REQUIRE(arg.ranges()[0].last() == 4095);
+		REQUIRE(arg.count() == 4097);
+
+		int sum = 0;
+		for (int value : arg.ranges()[0])
+			sum += value;
+		REQUIRE(sum == 4095 * 4096 / 2);
+	}
+	SECTION("Parsing of MultiInt negative values") {
+		args_parse::MultiArg<int> arg('i', "ids");
+		parser.add(&arg);
+
+		const char* argv[] = { "args_parse_demo", "--ids=-5,-3--1" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE(arg.singles() == std::vector<int>{ -5 });
+		REQUIRE(arg.ranges() == std::vector<args_parse::IntRange>{ args_parse::IntRange(-3, -1, 1) });
+		REQUIRE_FALSE(arg.ranges()[0] == args_parse::IntRange(-3, -1, 0));
+		REQUIRE(arg.values() == std::vector<int>{ -5, -3, -2, -1 });
+	}
+	SECTION("MultiInt keeps the order of values and ranges") {
+		args_parse::MultiArg<int> arg('i', "ids");
+		parser.add(&arg);
+
+		const char* argv[] = { "args_parse_demo", "--ids=5,0-3,7", "-i", "1-2" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE(arg.singles() == std::vector<int>{ 5, 7 });
+		REQUIRE(arg.values() == std::vector<int>{ 5, 0, 1, 2, 3, 7, 1, 2 });
+		REQUIRE(arg.values().size() == arg.count());
+	}
+	SECTION("Parsing of MultiFloat comma separated list") {
+		args_parse::MultiArg<float> arg('m', "multi");
+		parser.add(&arg);
+
+		const char* argv[] = { "args_parse_demo", "--multi=1.5,2.5", "3.5" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE(arg.values() == std::vector<float>{ 1.5f, 2.5f });
+	}
+	SECTION("Invalid list is rejected as a whole") {
+		args_parse::MultiArg<int> arg('i', "ids");
+		parser.add(&arg);
+
+		const char* argv[] = { "args_parse_demo", "--ids=1,2,x", "--ids=1,", "--ids=5-1" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE_FALSE(arg.isDefined());
+	}
+}
+
+TEST_CASE("Collecting diagnostics", "[diagnostics]") {
+	args_parse::ArgsParser parser;
+	std::vector<args_parse::Diagnostic> sinkDiagnostics;
+	parser.setDiagnosticSink([&](const args_parse::Diagnostic& diagnostic) { sinkDiagnostics.push_back(diagnostic); });
+
+	SECTION("Invalid value is collected with argument and token") {
+		args_parse::SingleArg<int> arg('i', "int");
+		parser.add(&arg);
+
+		const char* argv[] = { "args_parse_demo", "--int=abc" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE_FALSE(arg.isDefined());
+		REQUIRE(parser.diagnostics().size() == 1);
+		REQUIRE(parser.diagnostics()[0].code == args_parse::ErrorCode::InvalidValue);
+		REQUIRE(parser.diagnostics()[0].argument == "--int");
+		REQUIRE(parser.diagnostics()[0].token == "abc");
+		REQUIRE(sinkDiagnostics.size() == 1);
+	}
+	SECTION("Unknown and duplicate arguments are collected") {
+		args_parse::SingleArg<int> arg1('i', "int");
+		args_parse::SingleArg<int> arg2('i', "other");
+		REQUIRE(parser.add(&arg1));
+		REQUIRE_FALSE(parser.add(&arg2));
+
+		const char* argv[] = { "args_parse_demo", "-x", "--long" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE(parser.diagnostics().size() == 3);
+		REQUIRE(parser.diagnostics()[0].code == args_parse::ErrorCode::DuplicateShortName);
+		REQUIRE(parser.diagnostics()[1].code == args_parse::ErrorCode::UnknownArgument);
+		REQUIRE(parser.diagnostics()[1].argument == "-x");
+		REQUIRE(parser.diagnostics()[2].argument == "--long");
+		REQUIRE(args_parse::formatDiagnostic(parser.diagnostics()[2]) == "Error: Unknown argument '--long'");
+
+		// повторный разбор не накапливает ошибки прошлого, ошибки добавления остаются
+		const char* argvAgain[] = { "args_parse_demo", "-i", "1" };
+		parser.parse(static_cast<int>(std::size(argvAgain)), argvAgain);
+
+		REQUIRE(parser.diagnostics().size() == 1);
+		REQUIRE(parser.diagnostics()[0].code == args_parse::ErrorCode::DuplicateShortName);
+	}
+	SECTION("Unsupported type is reported") {
+		args_parse::SingleArg<double> arg('d', "double");
+		parser.add(&arg);
+
+		const char* argv[] = { "args_parse_demo", "-d", "1.0" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE(parser.diagnostics().size() == 1);
+		REQUIRE(parser.diagnostics()[0].code == args_parse::ErrorCode::UnsupportedType);
+	}
+}
+
+TEST_CASE("Rendering help", "[help]") {
+	args_parse::ArgsParser parser;
+
+	SECTION("Help is ordered, grouped and aligned") {
+		args_parse::SingleArg<int> threads('t', "threads");
+		args_parse::SingleArg<bool> verbose;
+		args_parse::SingleArg<std::string> path("path");
+		args_parse::SingleArg<std::string> output('o', "output");
+		threads.SetDescription("number of threads");
+		verbose.SetDescription("verbose output");
+		path.SetDescription("root path");
+		output.SetDescription("output file");
+		path.SetGroup("Input");
+		output.SetGroup("Output");
+		verbose.setShortName('v');
+		parser.add(&threads);
+		parser.add(&path);
+		parser.add(&output);
+		parser.add(&verbose);
+
+		const std::string expected =
+			"Usage:\t[options]\t[description]\n"
+			"  -t, --threads    number of threads\n"
+			"  -v               verbose output\n"
+			"\n"
+			"Input:\n"
+			"      --path       root path\n"
+			"\n"
+			"Output:\n"
+			"  -o, --output     output file\n";
+		REQUIRE(parser.helpText() == expected);
+	}
+	SECTION("Help cache is rebuilt after add") {
+		args_parse::SingleArg<int> threads('t', "threads");
+		args_parse::SingleArg<int> depth('d', "depth");
+		parser.add(&threads);
+		const std::string first = parser.helpText();
+		REQUIRE(&parser.helpText() == &parser.helpText());
+		parser.add(&depth);
+		REQUIRE(parser.helpText() != first);
+		REQUIRE(parser.helpText().find("--depth") != std::string::npos);
+	}
+	SECTION("Help cache is rebuilt after description or group change") {
+		args_parse::SingleArg<int> threads('t', "threads");
+		parser.add(&threads);
+		REQUIRE(parser.helpText().find("worker count") == std::string::npos);
+		threads.SetDescription("worker count");
+		REQUIRE(parser.helpText().find("worker count") != std::string::npos);
+		threads.SetGroup("Tuning");
+		REQUIRE(parser.helpText().find("Tuning:") != std::string::npos);
+	}
+}
+
+TEST_CASE("Layered configuration sources", "[sources]") {
+	args_parse::ArgsParser parser;
+	parser.setDiagnosticSink(nullptr);
+
+	const std::filesystem::path tempDir = std::filesystem::temp_directory_path();
+	const std::string configPath = (tempDir / "args_parse_test_config.ini").string();
+	{
+		std::ofstream config(configPath);
+		config << "# test config\n"
+			<< "threads = 4\n"
+			<< "path=/from/file\n"
+			<< "ids = 1,2,10-12\n";
+	}
+#ifdef _WIN32
+	_putenv_s("ARGS_TEST_PATH", "/from/env");
+#else
+	setenv("ARGS_TEST_PATH", "/from/env", 1);
+#endif
+
+	args_parse::SingleArg<int> threads('t', "threads");
+	args_parse::SingleArg<std::string> path('p', "path");
+	args_parse::MultiArg<int> ids('i', "ids");
+	parser.add(&threads);
+	parser.add(&path);
+	parser.add(&ids);
+	parser.setEnvPrefix("ARGS_TEST");
+
+	SECTION("Command line wins over environment and config file") {
+		parser.setConfigFile(configPath);
+		const char* argv[] = { "args_parse_demo", "--threads=8", "-p", "/from/argv" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE(threads.value() == 8);
+		REQUIRE(path.value() == "/from/argv");
+		REQUIRE(ids.values() == std::vector<int>{ 1, 2, 10, 11, 12 });
+		REQUIRE(ids.count() == 5);
+		REQUIRE(parser.diagnostics().empty());
+	}
+	SECTION("Environment wins over config file") {
+		parser.setConfigFile(configPath);
+		const char* argv[] = { "args_parse_demo" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE(threads.value() == 4);
+		REQUIRE(path.value() == "/from/env");
+	}
+	SECTION("Missing config file is reported") {
+		parser.setConfigFile((tempDir / "args_parse_missing_config.ini").string());
+		const char* argv[] = { "args_parse_demo" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE_FALSE(threads.isDefined());
+		REQUIRE(parser.diagnostics().size() == 1);
+		REQUIRE(parser.diagnostics()[0].code == args_parse::ErrorCode::ConfigFileUnavailable);
+	}
+
+	std::remove(configPath.c_str());
+#ifdef _WIN32
+	_putenv_s("ARGS_TEST_PATH", "");
+#else
+	unsetenv("ARGS_TEST_PATH");
+#endif
+}
+
+TEST_CASE("Constraint validation during parsing", "[constraints]") {
+	args_parse::ArgsParser parser;
+	parser.setDiagnosticSink(nullptr);
+
+	SECTION("Range is checked for single and multi values") {
+		args_parse::SingleArg<int> threads('t', "threads");
+		args_parse::MultiArg<int> shards('s', "shards");
+		threads.setRange(1, 64);
+		shards.setRange(0, 4095);
+		parser.add(&threads);
+		parser.add(&shards);
+
+		const char* argv[] = { "args_parse_demo", "-t", "128", "--shards=0-4095", "--shards=1,5000" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE_FALSE(threads.isDefined());
+		REQUIRE(shards.count() == 4096);
+		REQUIRE(parser.diagnostics().size() == 2);
+		REQUIRE(parser.diagnostics()[0].code == args_parse::ErrorCode::OutOfRange);
+		REQUIRE(parser.diagnostics()[1].token == "1,5000");
+	}
+	SECTION("Choices, prefix and pattern are checked for strings") {
+		args_parse::SingleArg<std::string> mode('m', "mode");
+		args_parse::SingleArg<std::string> name('n', "name");
+		args_parse::MultiArg<std::string> files('f', "files");
+		mode.setChoices({ "fast", "safe", "debug" });
+		name.setPrefix("job-");
+		files.setPattern("*.txt");
+		parser.add(&mode);
+		parser.add(&name);
+		parser.add(&files);
+
+		const char* argv[] = { "args_parse_demo", "--mode=slow", "--mode=safe", "-n", "task-1", "-f", "a.txt", "b.csv" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE(mode.value() == "safe");
+		REQUIRE_FALSE(name.isDefined());
+		REQUIRE(files.values() == std::vector<std::string>{ "a.txt" });
+		REQUIRE(parser.diagnostics().size() == 3);
+		REQUIRE(parser.diagnostics()[0].code == args_parse::ErrorCode::NotInChoices);
+		REQUIRE(parser.diagnostics()[1].code == args_parse::ErrorCode::PatternMismatch);
+		REQUIRE(parser.diagnostics()[2].code == args_parse::ErrorCode::PatternMismatch);
+	}
+	SECTION("Required and mutually exclusive arguments") {
+		args_parse::SingleArg<std::string> path('p', "path");
+		args_parse::SingleArg<bool> quiet('q', "quiet");
+		args_parse::SingleArg<bool> verbose('v', "verbose");
+		path.setRequired(true);
+		parser.add(&path);
+		parser.add(&quiet);
+		parser.add(&verbose);
+		parser.addExclusiveGroup({ &quiet, &verbose });
+
+		const char* argv[] = { "args_parse_demo", "-q", "1", "-v", "1" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE(parser.diagnostics().size() == 2);
+		REQUIRE(parser.diagnostics()[0].code == args_parse::ErrorCode::MissingRequired);
+		REQUIRE(parser.diagnostics()[0].argument == "--path");
+		REQUIRE(parser.diagnostics()[1].code == args_parse::ErrorCode::MutuallyExclusive);
+		REQUIRE(parser.diagnostics()[1].argument == "--verbose");
+		REQUIRE(parser.diagnostics()[1].token == "--quiet");
+	}
+	SECTION("Environment fallback does not conflict with an exclusive peer from argv") {
+		setenv("ARGS_GROUP_ALPHA", "1", 1);
+		setenv("ARGS_GROUP_GAMMA", "3", 1);
+		args_parse::SingleArg<int> alpha('a', "alpha");
+		args_parse::SingleArg<int> beta('b', "beta");
+		args_parse::SingleArg<int> gamma('g', "gamma");
+		parser.setEnvPrefix("ARGS_GROUP");
+		parser.add(&alpha);
+		parser.add(&beta);
+		parser.add(&gamma);
+		parser.addExclusiveGroup({ &alpha, &beta });
+
+		const char* argv[] = { "args_parse_demo", "--beta=2" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+		unsetenv("ARGS_GROUP_ALPHA");
+		unsetenv("ARGS_GROUP_GAMMA");
+
+		REQUIRE(parser.diagnostics().empty());
+		REQUIRE(beta.value() == 2);
+		REQUIRE_FALSE(alpha.isDefined());
+		REQUIRE(gamma.value() == 3);
+	}
+}
+
+TEST_CASE("Choice set lookup", "[choices]") {
+	std::vector<std::string> names;
+	for (int i = 0; i < 500; ++i)
+		names.push_back("choice" + std::to_string(i));
+	args_parse::ChoiceSet choices(names);
+
+	for (int i = 0; i < 500; ++i)
+		REQUIRE(choices.find(names[i]) == i);
+	REQUIRE(choices.find("choice500") == -1);
+	REQUIRE(choices.find("") == -1);
+	REQUIRE(args_parse::MatchPattern("a*b?c", "axxbyc"));
+	REQUIRE_FALSE(args_parse::MatchPattern("a*b?c", "axxbc"));
+}
+
+TEST_CASE("Abbreviations and suggestions for long names", "[name_tree]") {
+	args_parse::ArgsParser parser;
+	parser.setDiagnosticSink(nullptr);
+
+	args_parse::SingleArg<int> threads('t', "threads");
+	args_parse::SingleArg<int> threshold("threshold");
+	args_parse::SingleArg<std::string> input('i', "input");
+	args_parse::SingleArg<std::string> in("in");
+	parser.add(&threads);
+	parser.add(&threshold);
+	parser.add(&input);
+	parser.add(&in);
+
+	SECTION("Unique prefix resolves to the full name") {
+		const char* argv[] = { "args_parse_demo", "--threa", "4", "--thres=7", "--inp", "file" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE(threads.value() == 4);
+		REQUIRE(threshold.value() == 7);
+		REQUIRE(input.value() == "file");
+		REQUIRE(parser.diagnostics().empty());
+	}
+	SECTION("Exact name wins over longer names with the same prefix") {
+		const char* argv[] = { "args_parse_demo", "--in=a" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE(in.value() == "a");
+		REQUIRE_FALSE(input.isDefined());
+	}
+	SECTION("Ambiguous prefix is reported with candidates") {
+		const char* argv[] = { "args_parse_demo", "--thr=1" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE(parser.diagnostics().size() == 1);
+		REQUIRE(parser.diagnostics()[0].code == args_parse::ErrorCode::AmbiguousArgument);
+		REQUIRE(parser.diagnostics()[0].token == "'--threads', '--threshold'");
+	}
+	SECTION("Typo is reported with suggestions") {
+		const char* argv[] = { "args_parse_demo", "--thraeds=1", "--zzz" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE(parser.diagnostics().size() == 2);
+		REQUIRE(parser.diagnostics()[0].code == args_parse::ErrorCode::UnknownArgument);
+		REQUIRE(parser.diagnostics()[0].token == "'--threads'");
+		REQUIRE(args_parse::formatDiagnostic(parser.diagnostics()[0]) == "Error: Unknown argument '--thraeds', did you mean '--threads'?");
+		REQUIRE(parser.diagnostics()[1].token.empty());
+	}
+	SECTION("Bare -- is not an abbreviation of every name") {
+		const char* argv[] = { "args_parse_demo", "--", "5", "--=6" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE(parser.diagnostics().size() == 2);
+		REQUIRE(parser.diagnostics()[0].code == args_parse::ErrorCode::UnknownArgument);
+		REQUIRE(parser.diagnostics()[0].argument == "--");
+		REQUIRE(parser.diagnostics()[1].code == args_parse::ErrorCode::UnknownArgument);
+		REQUIRE_FALSE(threads.isDefined());
+		REQUIRE_FALSE(input.isDefined());
+	}
+	SECTION("Bare -- does not select the only long name") {
+		args_parse::ArgsParser single;
+		single.setDiagnosticSink(nullptr);
+		args_parse::SingleArg<int> number('n', "number");
+		single.add(&number);
+		const char* argv[] = { "args_parse_demo", "--", "5" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		single.parse(argc, argv);
+
+		REQUIRE_FALSE(number.isDefined());
+		REQUIRE(single.diagnostics().size() == 1);
+		REQUIRE(single.diagnostics()[0].code == args_parse::ErrorCode::UnknownArgument);
+	}
+	SECTION("Abbreviations can be disabled") {
+		parser.setAllowAbbreviations(false);
+		const char* argv[] = { "args_parse_demo", "--threa=4" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		parser.parse(argc, argv);
+
+		REQUIRE_FALSE(threads.isDefined());
+		REQUIRE(parser.diagnostics()[0].code == args_parse::ErrorCode::UnknownArgument);
+	}
+}
+
+TEST_CASE("Name tree over many names", "[name_tree]") {
+	std::vector<std::string> storage;
+	for (int i = 0; i < 10000; ++i)
+		storage.push_back("option-" + std::to_string(i));
+	std::vector<std::string_view> names(storage.begin(), storage.end());
+	std::vector<int> ids;
+	for (int i = 0; i < 10000; ++i)
+		ids.push_back(i);
+	args_parse::NameTree tree;
+	tree.build(names, ids);
+
+	REQUIRE(tree.resolvePrefix("option-1234") == 1234);
+	REQUIRE(tree.resolvePrefix("option-9999") == 9999);
+	REQUIRE(tree.resolvePrefix("option-12") == 12);
+	REQUIRE(tree.resolvePrefix("option-99") == 99);
+	REQUIRE(tree.resolvePrefix("option-") == args_parse::NameTree::Ambiguous);
+	REQUIRE(tree.resolvePrefix("opt1") == args_parse::NameTree::NotFound);
+
+	auto suggestions = tree.suggest("opton-4321", 1, 3);
+	REQUIRE(suggestions.size() == 1);
+	REQUIRE(suggestions[0].id == 4321);
+	REQUIRE(suggestions[0].distance == 1);
+}
+
+TEST_CASE("Completion table", "[completion]") {
+	args_parse::ArgsParser parser;
+	args_parse::SingleArg<int> threads('t', "threads");
+	args_parse::SingleArg<int> threshold("threshold");
+	args_parse::SingleArg<std::string> mode('m', "mode");
+	args_parse::MultiArg<bool> flags('f', "flags");
+	args_parse::SingleArg<std::string> output;
+	output.setShortName('o');
+	mode.setChoices({ "fast", "safe", "full" });
+	parser.add(&threads);
+	parser.add(&threshold);
+	parser.add(&mode);
+	parser.add(&flags);
+	parser.add(&output);
+
+	const std::string path = "args_parse_test.complete";
+	REQUIRE(args_parse::saveCompletionTable(parser, path));
+
+	args_parse::CompletionIndex index;
+	REQUIRE(index.open(path));
+
+	SECTION("Long names by prefix") {
+		REQUIRE(index.complete("", "--thr") == std::vector<std::string>{ "--threads", "--threshold" });
+		REQUIRE(index.complete("", "--x").empty());
+	}
+	SECTION("Short names") {
+		REQUIRE(index.complete("", "-").size() == 4);
+	}
+	SECTION("Values after an option") {
+		REQUIRE(index.complete("--mode", "f") == std::vector<std::string>{ "fast", "full" });
+		REQUIRE(index.complete("-m", "") == std::vector<std::string>{ "fast", "safe", "full" });
+		REQUIRE(index.complete("--flags", "t") == std::vector<std::string>{ "true" });
+	}
+	SECTION("Values after an equals sign") {
+		REQUIRE(index.complete("", "--mode=s") == std::vector<std::string>{ "--mode=safe" });
+	}
+	SECTION("Corrupted table is rejected") {
+		std::string table = args_parse::buildCompletionTable(parser);
+		table.resize(table.size() - 1);
+		{
+			std::ofstream file(path, std::ios::binary);
+			file << table;
+		}
+		args_parse::CompletionIndex broken;
+		REQUIRE_FALSE(broken.open(path));
+	}
+	SECTION("Table with references outside the file is rejected") {
+		const std::string table = args_parse::buildCompletionTable(parser);
+		auto rewrite = [&](auto&& patch) {
+			std::string copy = table;
+			args_parse::CompletionEntry entry;
+			std::memcpy(&entry, copy.data() + sizeof(args_parse::CompletionHeader), sizeof(entry));
+			patch(entry);
+			std::memcpy(copy.data() + sizeof(args_parse::CompletionHeader), &entry, sizeof(entry));
+			std::ofstream file(path, std::ios::binary);
+			file << copy;
+		};
+		args_parse::CompletionIndex broken;
+		rewrite([](args_parse::CompletionEntry& entry) { entry.longName.offset = 0xFFFFFFF0u; });
+		REQUIRE_FALSE(broken.open(path));
+		rewrite([](args_parse::CompletionEntry& entry) { entry.choicesCount = 100; });
+		REQUIRE_FALSE(broken.open(path));
+		rewrite([](args_parse::CompletionEntry&) {});
+		REQUIRE(broken.open(path));
+	}
+	SECTION("Table built in memory answers like the file") {
+		args_parse::CompletionIndex inMemory;
+		REQUIRE(inMemory.assign(args_parse::buildCompletionTable(parser)));
+		REQUIRE(inMemory.complete("", "--thr") == index.complete("", "--thr"));
+		REQUIRE(inMemory.complete("-m", "") == std::vector<std::string>{ "fast", "safe", "full" });
+		REQUIRE_FALSE(inMemory.assign("APCT"));
+	}
+	SECTION("Missing index falls through to the parser") {
+		const char* argv[] = { "args_parse_demo", "--complete", "", "--thr" };
+		const int argc = static_cast<int>(std::size(argv));
+		REQUIRE_FALSE(args_parse::completeFromIndex(argc, argv, "missing.complete"));
+		const char* plain[] = { "args_parse_demo", "--threads=1" };
+		REQUIRE_FALSE(args_parse::completeFromParser(parser, 2, plain));
+	}
+
+	std::remove(path.c_str());
+}
+
+namespace {
+	struct StaticOptions {
+		int threads = 1;
+		float ratio = 0.0f;
+		bool verbose = false;
+		std::string_view path;
+		std::string name;
+		args_parse::UserChrono timeout;
+	};
+
+	constexpr auto staticParser = args_parse::makeStaticParser(
+		args_parse::option<&StaticOptions::threads>('t', "threads"),
+		args_parse::option<&StaticOptions::ratio>("ratio"),
+		args_parse::option<&StaticOptions::verbose>('v', "verbose"),
+		args_parse::option<&StaticOptions::path>('p', "path"),
+		args_parse::option<&StaticOptions::name>('n', "name"),
+		args_parse::option<&StaticOptions::timeout>("timeout"));
+}
+
+TEST_CASE("Snapshot of parsed values", "[snapshot]") {
+	struct Options {
+		args_parse::SingleArg<int> threads{ 't', "threads" };
+		args_parse::SingleArg<float> ratio{ "ratio" };
+		args_parse::SingleArg<bool> verbose{ 'v', "verbose" };
+		args_parse::SingleArg<std::string> name{ "name" };
+		args_parse::SingleArg<args_parse::UserChrono> timeout{ "timeout" };
+		args_parse::MultiArg<int> ids{ "ids" };
+		args_parse::MultiArg<float> weights{ "weights" };
+		args_parse::MultiArg<bool> flags{ "flags" };
+		args_parse::MultiArg<std::string> tags{ "tags" };
+		args_parse::SingleArg<int> unused{ "unused" };
+		args_parse::ArgsParser parser;
+
+		Options() {
+			for (args_parse::Arg* arg : std::initializer_list<args_parse::Arg*>{ &threads, &ratio, &verbose, &name, &timeout, &ids, &weights, &flags, &tags, &unused })
+				parser.add(arg);
+		}
+	};
+
+	Options source;
+	const char* argv[] = { "prog", "-t", "8", "--ratio=0.5", "-v", "true", "--name", "report", "--timeout", "90s",
+		"--ids", "1,4-6", "--weights", "0.25", "--flags", "false", "--tags", "a", "--tags", "b c" };
+	source.parser.parse(static_cast<int>(std::size(argv)), argv);
+	REQUIRE(source.parser.diagnostics().empty());
+	const std::string snapshot = args_parse::saveState(source.parser);
+
+	SECTION("Round trip of every supported type") {
+		Options target;
+		REQUIRE(args_parse::loadState(target.parser, snapshot));
+		REQUIRE(target.threads.value() == 8);
+		REQUIRE(target.ratio.value() == 0.5f);
+		REQUIRE(target.verbose.value());
+		REQUIRE(target.name.value() == "report");
+		REQUIRE(target.timeout.value().GetMicroseconds() == source.timeout.value().GetMicroseconds());
+		REQUIRE(target.ids.values() == source.ids.values());
+		REQUIRE(target.ids.ranges() == source.ids.ranges());
+		REQUIRE(target.ids.singles() == source.ids.singles());
+		REQUIRE(target.weights.values() == std::vector<float>{ 0.25f });
+		REQUIRE(target.flags.values() == std::vector<bool>{ false });
+		REQUIRE(target.tags.values() == std::vector<std::string>{ "a", "b c" });
+		REQUIRE(!target.unused.isDefined());
+	}
+	SECTION("Round trip through a file and a descriptor") {
+		const std::string path = "args_parse_test.snapshot";
+		REQUIRE(args_parse::saveStateToFile(source.parser, path));
+		Options fromFile;
+		REQUIRE(args_parse::loadStateFromFile(fromFile.parser, path));
+		REQUIRE(fromFile.name.value() == "report");
+
+		std::FILE* file = std::fopen(path.c_str(), "rb");
+		REQUIRE(file);
+		Options fromFd;
+		REQUIRE(args_parse::loadStateFromFd(fromFd.parser, fileno(file)));
+		std::fclose(file);
+		REQUIRE(fromFd.ids.values() == source.ids.values());
+		std::remove(path.c_str());
+	}
+	SECTION("Damaged or mismatched snapshots are rejected") {
+		Options target;
+		REQUIRE(!args_parse::loadState(target.parser, snapshot.substr(0, snapshot.size() - 1)));
+		REQUIRE(!args_parse::loadState(target.parser, snapshot + "x"));
+		std::string wrongVersion = snapshot;
+		wrongVersion[4] = 2;
+		REQUIRE(!args_parse::loadState(target.parser, wrongVersion));
+		REQUIRE(!target.threads.isDefined());
+
+		// повреждены данные последней записи: предыдущие аргументы не должны получить значения
+		std::string badPayload = snapshot;
+		const uint32_t rangeCount = 1;
+		std::memcpy(&badPayload[badPayload.size() - sizeof(rangeCount)], &rangeCount, sizeof(rangeCount));
+		REQUIRE(!args_parse::loadState(target.parser, badPayload));
+		REQUIRE(!target.threads.isDefined());
+		REQUIRE(!target.ids.isDefined());
+
+		// недостоверное количество записей не приводит к огромному резервированию
+		std::string hugeCount = snapshot;
+		const uint32_t entryCount = 0xFFFFFFFFu;
+		std::memcpy(&hugeCount[offsetof(args_parse::SnapshotHeader, entryCount)], &entryCount, sizeof(entryCount));
+		REQUIRE(!args_parse::loadState(target.parser, hugeCount));
+
+		args_parse::ArgsParser other;
+		args_parse::SingleArg<std::string> threads{ 't', "threads" };
+		other.add(&threads);
+		REQUIRE(!args_parse::loadState(other, snapshot));
+	}
+	SECTION("Argument without a long name is found by its short name") {
+		args_parse::ArgsParser shortSource;
+		args_parse::SingleArg<int> level;
+		level.setShortName('l');
+		shortSource.add(&level);
+		const char* shortArgv[] = { "prog", "-l", "3" };
+		shortSource.parse(3, shortArgv);
+		const std::string shortSnapshot = args_parse::saveState(shortSource);
+
+		args_parse::ArgsParser shortTarget;
+		args_parse::SingleArg<int> target;
+		target.setShortName('l');
+		shortTarget.add(&target);
+		REQUIRE(args_parse::loadState(shortTarget, shortSnapshot));
+		REQUIRE(target.value() == 3);
+
+		// запись без длинного имени не подходит аргументу с длинным именем и тем же коротким
+		args_parse::ArgsParser longTarget;
+		args_parse::SingleArg<int> named('l', "level");
+		longTarget.add(&named);
+		REQUIRE(!args_parse::loadState(longTarget, shortSnapshot));
+	}
+}
+
+TEST_CASE("Tracing parser phases", "[trace]") {
+	args_parse::ArgsParser parser;
+	args_parse::SingleArg<int> threads('t', "threads");
+	parser.add(&threads);
+	const char* argv[] = { "prog", "-t", "4" };
+	args_parse::Trace::clear();
+
+	SECTION("Disabled tracing records nothing") {
+		args_parse::Trace::enable(false);
+		parser.parse(3, argv);
+		REQUIRE(args_parse::Trace::chromeJson().find("ArgsParser::parse") == std::string::npos);
+	}
+	SECTION("Parse phases become complete events") {
+		args_parse::Trace::enable(true);
+		parser.parse(3, argv);
+		{
+			args_parse::TraceSpan span("custom");
+			span.setDetail("say \"hi\"");
+			span.setArg1("count", 7);
+		}
+		args_parse::Trace::enable(false);
+		const std::string json = args_parse::Trace::chromeJson();
+		REQUIRE(json.find("\"name\":\"ArgsParser::parse\"") != std::string::npos);
+		REQUIRE(json.find("\"name\":\"ArgsParser::parse/argv\"") != std::string::npos);
+		REQUIRE(json.find("\"name\":\"ArgsParser::parse/sources\"") != std::string::npos);
+		REQUIRE(json.find("\"name\":\"ArgsParser::parse/constraints\"") != std::string::npos);
+		REQUIRE(json.find("\"argc\":3") != std::string::npos);
+		REQUIRE(json.find("\"detail\":\"say \\\"hi\\\"\",\"count\":7") != std::string::npos);
+		REQUIRE(json.find("\"ph\":\"X\"") != std::string::npos);
+	}
+	SECTION("Ring buffer keeps the newest events") {
+		args_parse::Trace::enable(true);
+		for (size_t i = 0; i < args_parse::Trace::BufferSize + 10; ++i) {
+			args_parse::TraceSpan span("ring");
+			span.setArg1("index", i);
+		}
+		args_parse::Trace::enable(false);
+		const std::string json = args_parse::Trace::chromeJson();
+		REQUIRE(json.find("\"index\":9}") == std::string::npos);
+		REQUIRE(json.find("\"index\":10}") != std::string::npos);
+		REQUIRE(json.find("\"index\":" + std::to_string(args_parse::Trace::BufferSize + 9) + "}") != std::string::npos);
+	}
+	SECTION("Events are read while another thread keeps writing") {
+		args_parse::Trace::enable(true);
+		std::atomic<bool> stop{ false };
+		std::thread writer([&] {
+			// чередование длин строки: разорванное событие дало бы строку, не совпадающую ни с одним вариантом
+			for (uint64_t i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+				args_parse::TraceSpan span("writer");
+				span.setDetail(i % 2 ? "odd-odd-odd-odd" : "even");
+			}
+			});
+		size_t torn = 0;
+		for (int round = 0; round < 20; ++round) {
+			const std::string json = args_parse::Trace::chromeJson();
+			for (size_t pos = json.find("\"detail\":\""); pos != std::string::npos; pos = json.find("\"detail\":\"", pos + 1)) {
+				const std::string_view value = std::string_view(json).substr(pos + 10, json.find('"', pos + 10) - pos - 10);
+				if (value != "odd-odd-odd-odd" && value != "even")
+					++torn;
+			}
+		}
+		stop = true;
+		writer.join();
+		args_parse::Trace::enable(false);
+		REQUIRE(torn == 0);
+	}
+	args_parse::Trace::clear();
+}
+
+TEST_CASE("Static parsing into a struct", "[static_parser]") {
+	StaticOptions options;
+
+	SECTION("Values are written directly into struct fields") {
+		const char* argv[] = { "args_parse_demo", "-t", "8", "--ratio=0.5", "-v1", "--path", "/tmp", "-n=job", "--timeout=3s" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		auto result = staticParser.parse(argc, argv, options);
+
+		REQUIRE(result);
+		REQUIRE(result.present.all());
+		REQUIRE(options.threads == 8);
+		REQUIRE(options.ratio == 0.5f);
+		REQUIRE(options.verbose);
+		REQUIRE(options.path == "/tmp");
+		REQUIRE(options.name == "job");
+		REQUIRE(options.timeout.GetMicroseconds().count() == 3000000);
+	}
+	SECTION("Errors are reported with code and argv position") {
+		const char* argv[] = { "args_parse_demo", "-t", "8", "--threads=x" };
+		const int argc = static_cast<int>(std::size(argv));
+
+		auto result = staticParser.parse(argc, argv, options);
+
+		REQUIRE_FALSE(result);
+		REQUIRE(result.code == args_parse::ErrorCode::InvalidValue);
+		REQUIRE(result.index == 3);
+		REQUIRE(options.threads == 8);
+	}
+	SECTION("Unknown option and missing value") {
+		const char* unknown[] = { "args_parse_demo", "--unknown=1" };
+		REQUIRE(staticParser.parse(2, unknown, options).code == args_parse::ErrorCode::UnknownArgument);
+
+		const char* missing[] = { "args_parse_demo", "--threads" };
+		REQUIRE(staticParser.parse(2, missing, options).code == args_parse::ErrorCode::InvalidValue);
+	}
+}
+
+TEST_CASE("Batch parsing into columns", "[batch]") {
+	args_parse::ArgsParser parser;
+	args_parse::SingleArg<int> threads('t', "threads");
+	args_parse::SingleArg<std::string> name('n', "name");
+	args_parse::MultiArg<int> ids('i', "ids");
+	args_parse::SingleArg<bool> verbose('v', "verbose");
+	threads.setRange(1, 64);
+	parser.add(&threads);
+	parser.add(&name);
+	parser.add(&ids);
+	parser.add(&verbose);
+
+	args_parse::BatchParser batch(parser);
+
+	SECTION("Command lines in argv form") {
+		std::vector<std::vector<const char*>> lines = {
+			{ "job", "-t", "4", "--name=a", "--ids=1,2" },
+			{ "job", "--thr=8", "-i", "5-7", "9" },
+			{ "job", "-t", "100", "--bogus" },
+		};
+
+		auto result = batch.parse(lines, 2);
+
+		REQUIRE(result.rows == 3);
+		const auto* threadsColumn = result.column("threads");
+		REQUIRE(threadsColumn);
+		REQUIRE(threadsColumn->values<int>() == std::vector<int>{ 4, 8, 0 });
+		REQUIRE(threadsColumn->isPresent(0));
+		REQUIRE(threadsColumn->isPresent(1));
+		REQUIRE_FALSE(threadsColumn->isPresent(2));
+
+		const auto* nameColumn = result.column("name");
+		REQUIRE(nameColumn->values<std::string>() == std::vector<std::string>{ "a", "", "" });
+
+		const auto* idsColumn = result.column("ids");
+		REQUIRE(idsColumn->values<int>() == std::vector<int>{ 1, 2, 5, 6, 7, 9 });
+		REQUIRE(idsColumn->offsets() == std::vector<uint32_t>{ 0, 2, 6, 6 });
+
+		REQUIRE(result.errors.size() == 2);
+		REQUIRE(result.errors[0].row == 2);
+		REQUIRE(result.errors[0].diagnostic.code == args_parse::ErrorCode::OutOfRange);
+		REQUIRE(result.errors[1].diagnostic.code == args_parse::ErrorCode::UnknownArgument);
+
+		// аргументы парсера не меняются
+		REQUIRE_FALSE(threads.isDefined());
+	}
+	SECTION("Many command lines from one buffer are parsed in parallel") {
+		std::string buffer;
+		const size_t rows = 1000;
+		for (size_t row = 0; row < rows; ++row)
+			buffer += "-t " + std::to_string(row % 64 + 1) + " -v " + (row % 3 == 0 ? "true" : "false") + "\n";
+
+		auto result = batch.parse(buffer, 4);
+
+		REQUIRE(result.rows == rows);
+		REQUIRE(result.errors.empty());
+		const auto& values = result.column("threads")->values<int>();
+		const auto& flags = result.column("verbose")->values<bool>();
+		size_t mismatches = 0;
+		for (size_t row = 0; row < rows; ++row) {
+			// блоки по 250 строк делят слова битовой карты между потоками
+			if (values[row] != static_cast<int>(row % 64 + 1) || flags[row] != (row % 3 == 0)
+				|| !result.column("threads")->isPresent(row))
+				++mismatches;
+		}
+		REQUIRE(mismatches == 0);
+		REQUIRE(result.column("name")->presence() == std::vector<uint64_t>((rows + 63) / 64, 0));
+	}
+	SECTION("Huge ranges are rejected instead of expanded") {
+		auto result = batch.parse(std::string_view("--ids=0-2147483647\n--ids=3,0-2\n"), 1);
+
+		REQUIRE(result.errors.size() == 1);
+		REQUIRE(result.errors[0].row == 0);
+		REQUIRE(result.errors[0].diagnostic.code == args_parse::ErrorCode::RangeTooLarge);
+		REQUIRE(result.errors[0].diagnostic.argument == "--ids");
+		REQUIRE(result.column("ids")->values<int>() == std::vector<int>{ 3, 0, 1, 2 });
+	}
+}
+
+namespace {
+	/// @brief записать файл целиком
+	void writeFile(const std::filesystem::path& path, const std::string& content) {
+		std::ofstream file(path, std::ios::binary);
+		file << content;
+	}
+}
+
+TEST_CASE("Duplicate files", "[duplicates]") {
+	const std::filesystem::path root = std::filesystem::temp_directory_path() / "args_parse_test_duplicates";
+	std::filesystem::remove_all(root);
+	std::filesystem::create_directories(root);
+	auto path = [&](const char* name) { return (root / name).string(); };
+
+	SECTION("Files are grouped by size and confirmed by content") {
+		// маленькие файлы хешируются целиком на частичном проходе
+		writeFile(path("same-a"), "hello world");
+		writeFile(path("same-b"), "hello world");
+		writeFile(path("other"), "hello there");
+		writeFile(path("unique"), "abc");
+		writeFile(path("empty-a"), "");
+		writeFile(path("empty-b"), "");
+		// большие файлы с одинаковыми первым и последним блоком различаются только полным хешем
+		std::string big(3 * 4096 + 100, 'x');
+		for (size_t i = 0; i < big.size(); ++i)
+			big[i] = static_cast<char>('a' + i % 26);
+		writeFile(path("big-a"), big);
+		writeFile(path("big-b"), big);
+		big[big.size() / 2] = '#';
+		writeFile(path("big-c"), big);
+		std::filesystem::create_symlink(path("same-a"), path("symlink"));
+
+		DuplicateFinder finder(2);
+		for (const char* name : { "same-a", "same-b", "other", "unique", "empty-a", "empty-b", "big-a", "big-b", "big-c", "symlink" })
+			finder.add(path(name));
+		const auto sets = finder.finish();
+
+		REQUIRE(sets.size() == 2);
+		REQUIRE(sets[0].size == big.size());
+		REQUIRE(sets[0].paths == std::vector<std::string>{ path("big-a"), path("big-b") });
+		REQUIRE(sets[1].size == 11);
+		REQUIRE(sets[1].paths == std::vector<std::string>{ path("same-a"), path("same-b") });
+	}
+	SECTION("Hard links are one candidate reported by the smallest path") {
+		writeFile(path("file"), "linked content");
+		writeFile(path("copy"), "linked content");
+		std::filesystem::create_hard_link(path("file"), path("link-z"));
+		std::filesystem::create_hard_link(path("file"), path("a-link"));
+
+		DuplicateFinder finder(2);
+		for (const char* name : { "file", "link-z", "a-link", "copy" })
+			finder.add(path(name));
+		const auto sets = finder.finish();
+
+		REQUIRE(sets.size() == 1);
+		REQUIRE(sets[0].paths == std::vector<std::string>{ path("a-link"), path("copy") });
+
+		// только ссылки на один inode дубликатами не считаются
+		DuplicateFinder linksOnly(1);
+		linksOnly.add(path("file"));
+		linksOnly.add(path("link-z"));
+		REQUIRE(linksOnly.finish().empty());
+	}
+	SECTION("Byte comparison splits paths with a colliding hash") {
+		// splitByContent получает пути, хеши которых совпали, и сам их не считает
+		writeFile(path("x1"), "hello world");
+		writeFile(path("x2"), "hello there");
+		writeFile(path("x3"), "hello world");
+		writeFile(path("x4"), "hello there");
+		writeFile(path("x5"), "hello_worl!");
+
+		const auto sets = splitByContent(11, { path("x4"), path("x3"), path("x5"), path("x2"), path("x1") });
+
+		REQUIRE(sets.size() == 2);
+		REQUIRE(sets[0].paths == std::vector<std::string>{ path("x1"), path("x3") });
+		REQUIRE(sets[1].paths == std::vector<std::string>{ path("x2"), path("x4") });
+		REQUIRE(splitByContent(11, { path("x1"), path("x2") }).empty());
+	}
+
+	std::filesystem::remove_all(root);
+}
+
+TEST_CASE("Visited files and directories", "[visited_set]") {
+	SECTION("Identity is device and inode") {
+		VisitedSet visited(3);
+		REQUIRE(visited.insert(1, 100));
+		REQUIRE_FALSE(visited.insert(1, 100));
+		REQUIRE(visited.insert(2, 100));
+		REQUIRE(visited.insert(1, 101));
+		REQUIRE(visited.size() == 3);
+	}
+	SECTION("Concurrent inserts accept each identity once") {
+		VisitedSet visited(4);
+		std::atomic<size_t> accepted{ 0 };
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; ++t) {
+			threads.emplace_back([&] {
+				for (uint64_t inode = 0; inode < 10000; ++inode) {
+					if (visited.insert(7, inode))
+						accepted.fetch_add(1, std::memory_order_relaxed);
+				}
+				});
+		}
+		for (auto& thread : threads)
+			thread.join();
+		REQUIRE(accepted == 10000);
+		REQUIRE(visited.size() == 10000);
+	}
+	SECTION("Link policy resolves paths to identities") {
+		const std::filesystem::path root = std::filesystem::temp_directory_path() / "args_parse_test_visited";
+		std::filesystem::remove_all(root);
+		std::filesystem::create_directories(root / "dir");
+		std::filesystem::create_directory_symlink(root / "dir", root / "dir-link");
+		writeFile(root / "single", "one link");
+		writeFile(root / "linked", "two links");
+		std::filesystem::create_hard_link(root / "linked", root / "linked-2");
+
+		VisitedSet visited;
+		LinkPolicy links;
+		links.visited = &visited;
+
+		// каталог по ссылке - тот же каталог
+		REQUIRE(links.firstVisit((root / "dir").string()));
+		REQUIRE_FALSE(links.firstVisit((root / "dir-link").string()));
+		REQUIRE_FALSE(links.firstVisit((root / "missing").string()));
+
+		// файл с одной жесткой ссылкой не запоминается, с несколькими - учитывается один раз
+		REQUIRE(links.firstLink((root / "single").string()));
+		REQUIRE(links.firstLink((root / "single").string()));
+		REQUIRE(links.firstLink((root / "linked").string()));
+		REQUIRE_FALSE(links.firstLink((root / "linked-2").string()));
+		REQUIRE(links.firstLink((root / "missing").string()));
+		REQUIRE(visited.size() == 2);
+
+		std::filesystem::remove_all(root);
+	}
+}